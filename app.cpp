@@ -30,17 +30,27 @@ int main(int argc, char* argv[])
       {"verbose", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'},
       {"time-limit", required_argument, 0, 'T'},
+      {"bucket-queue", no_argument, 0, 'b'},
+      {"dist-table-mb", required_argument, 0, 'M'},
+      {"threads", required_argument, 0, 't'},
+      {"dist-cache", required_argument, 0, 'D'},
+      {"node-order", required_argument, 0, 'O'},
       {"make-scen", no_argument, 0, 'P'},
       {0, 0, 0, 0},
   };
   bool make_scen = false;
   int max_comp_time = -1;
+  bool bucket_queue = false;
+  int max_distance_table_mb = 0;
+  int threads = 1;
+  std::string distance_table_cache = "";
+  std::string node_order = "row-major";
 
   // command line args
   int opt, longindex;
   opterr = 0;  // ignore getopt error
-  while ((opt = getopt_long(argc, argv, "i:o:s:vhPT:", longopts, &longindex)) !=
-         -1) {
+  while ((opt = getopt_long(argc, argv, "i:o:s:vhPT:bM:t:D:O:", longopts,
+                            &longindex)) != -1) {
     switch (opt) {
       case 'i':
         instance_file = std::string(optarg);
@@ -63,6 +73,21 @@ int main(int argc, char* argv[])
       case 'T':
         max_comp_time = std::atoi(optarg);
         break;
+      case 'b':
+        bucket_queue = true;
+        break;
+      case 'M':
+        max_distance_table_mb = std::atoi(optarg);
+        break;
+      case 't':
+        threads = std::atoi(optarg);
+        break;
+      case 'D':
+        distance_table_cache = std::string(optarg);
+        break;
+      case 'O':
+        node_order = std::string(optarg);
+        break;
       default:
         break;
     }
@@ -87,8 +112,15 @@ int main(int argc, char* argv[])
     return 0;
   }
 
+  // internal numbering of nodes
+  P.setNodeOrder(GraphView::getOrderByName(node_order));
+
   // solve
   auto solver = getSolver(solver_name, &P, verbose, argc, argv_copy);
+  solver->setBucketQueue(bucket_queue);
+  solver->setMaxDistanceTableMB(max_distance_table_mb);
+  solver->setThreads(threads);
+  solver->setDistanceTableCache(distance_table_cache);
   solver->solve();
   solver->printResult();
   solver->makeLog(output_file);
@@ -130,6 +162,15 @@ void printHelp()
             << "  -h --help                     help\n"
             << "  -s --solver [SOLVER_NAME]     solver, choose from the below\n"
             << "  -T --time-limit [INT]         max computation time (ms)\n"
+            << "  -b --bucket-queue             use bucket queue in A*\n"
+            << "  -M --dist-table-mb [INT]      memory limit of distance "
+               "tables (MB)\n"
+            << "  -t --threads [INT]            threads for distance tables "
+               "and PP restarts\n"
+            << "  -D --dist-cache [DIR]         directory of distance table "
+               "cache\n"
+            << "  -O --node-order [ORDER]       internal node order, "
+               "row-major/morton/hilbert\n"
             << "  -P --make-scen                make scenario file using "
                "random starts/goals"
             << "\n\nSolver Options:" << std::endl;
@@ -28,6 +28,10 @@ int main(int argc, char* argv[])
       {"verbose", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'},
       {"time-limit", required_argument, 0, 'T'},
+      {"bucket-queue", no_argument, 0, 'b'},
+      {"dist-table-mb", required_argument, 0, 'M'},
+      {"threads", required_argument, 0, 't'},
+      {"dist-cache", required_argument, 0, 'D'},
       {"vertex", required_argument, 0, 'n'},
       {"prob", required_argument, 0, 'p'},
       {"agent", required_argument, 0, 'k'},
@@ -35,6 +39,10 @@ int main(int argc, char* argv[])
       {0, 0, 0, 0},
   };
   int max_comp_time = -1;
+  bool bucket_queue = false;
+  int max_distance_table_mb = 0;
+  int threads = 1;
+  std::string distance_table_cache = "";
 
   int n = 0;     // #vertex
   float p = 0;   // prob
@@ -44,7 +52,7 @@ int main(int argc, char* argv[])
   // command line args
   int opt, longindex;
   opterr = 0;  // ignore getopt error
-  while ((opt = getopt_long(argc, argv, "o:s:vhT:n:p:k:r:", longopts,
+  while ((opt = getopt_long(argc, argv, "o:s:vhT:n:p:k:r:bM:t:D:", longopts,
                             &longindex)) != -1) {
     switch (opt) {
       case 'o':
@@ -62,6 +70,18 @@ int main(int argc, char* argv[])
       case 'T':
         max_comp_time = std::atoi(optarg);
         break;
+      case 'b':
+        bucket_queue = true;
+        break;
+      case 'M':
+        max_distance_table_mb = std::atoi(optarg);
+        break;
+      case 't':
+        threads = std::atoi(optarg);
+        break;
+      case 'D':
+        distance_table_cache = std::string(optarg);
+        break;
       case 'n':
         n = std::atoi(optarg);
         break;
@@ -94,6 +114,10 @@ int main(int argc, char* argv[])
 
   // solve
   auto solver = getSolver(solver_name, &P, verbose, argc, argv_copy);
+  solver->setBucketQueue(bucket_queue);
+  solver->setMaxDistanceTableMB(max_distance_table_mb);
+  solver->setThreads(threads);
+  solver->setDistanceTableCache(distance_table_cache);
   solver->solve();
   solver->printResult();
   solver->makeLog(output_file);
@@ -138,6 +162,13 @@ void printHelp()
             << "  -h --help                     help\n"
             << "  -s --solver [SOLVER_NAME]     solver, choose from the below\n"
             << "  -T --time-limit [INT]         max computation time (ms)\n"
+            << "  -b --bucket-queue             use bucket queue in A*\n"
+            << "  -M --dist-table-mb [INT]      memory limit of distance "
+               "tables (MB)\n"
+            << "  -t --threads [INT]            threads for distance tables "
+               "and PP restarts\n"
+            << "  -D --dist-cache [DIR]         directory of distance table "
+               "cache\n"
             << "\n\nSolver Options:" << std::endl;
   // each solver
   PP::printHelp();
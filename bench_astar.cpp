@@ -0,0 +1,127 @@
+#include <getopt.h>
+
+#include <iostream>
+#include <problem.hpp>
+#include <solver.hpp>
+
+void printHelp();
+
+// micro-benchmark of A-star search: std::function vs template callbacks,
+// binary heap vs bucket queue, and clock reads of the deadline
+class AstarBenchmark : public Solver
+{
+private:
+  const int repetitions;
+
+  void run()
+  {
+    // the same conditions as prioritized planning without fragments
+    auto compare = [&](AstarNode* a, AstarNode* b) {
+      if (a->f != b->f) return a->f > b->f;
+      if (a->g != b->g) return a->g < b->g;
+      return a->v->id < b->v->id;
+    };
+
+    // 0: std::function, 1: template, 2: template with bucket queue,
+    // 3: template, reading the clock at every expansion
+    auto key = [](AstarNode* a) { return a->f; };
+    for (int variant = 0; variant < 4; ++variant) {
+      use_bucket_queue = (variant == 2);
+      const int interval = Deadline::DEFAULT_CHECK_INTERVAL;
+      deadline.setCheckInterval(variant == 3 ? 1 : interval);
+      const uint64_t clock_cnt = deadline.getClockCnt();
+      workspace.expanded = 0;
+      auto t_s = Time::now();
+      for (int k = 0; k < repetitions; ++k) {
+        for (int i = 0; i < P->getNum(); ++i) {
+          Node* const g = P->getGoal(i);
+          auto checkInvalidMove = [&](Node* child, Node* parent) {
+            return child != g && table_goals[child->id];
+          };
+          if (variant > 0) {
+            getPath(i, checkInvalidMove, compare, key);
+          } else {
+            getPath(i, CheckInvalidMove(checkInvalidMove),
+                    CompareAstarNodes(compare));
+          }
+        }
+      }
+      const double elapsed = std::max(1.0, getElapsedTime(t_s));
+      std::cout << (variant == 0   ? "std::function"
+                    : variant == 1 ? "template     "
+                    : variant == 2 ? "bucket queue "
+                                   : "clock per pop")
+                << ", expanded: " << workspace.expanded
+                << ", elapsed(ms): " << elapsed << ", expansions/sec: "
+                << (uint64_t)(workspace.expanded * 1000 / elapsed)
+                << ", clock reads: " << deadline.getClockCnt() - clock_cnt
+                << std::endl;
+    }
+    solved = true;
+  }
+
+public:
+  AstarBenchmark(Problem* _P, const int _repetitions)
+      : Solver(_P), repetitions(_repetitions)
+  {
+    solver_name = "AstarBenchmark";
+  }
+};
+
+int main(int argc, char* argv[])
+{
+  std::string instance_file = "";
+  int repetitions = 10;
+
+  struct option longopts[] = {
+      {"instance", required_argument, 0, 'i'},
+      {"repetitions", required_argument, 0, 'r'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0},
+  };
+
+  // command line args
+  int opt, longindex;
+  opterr = 0;  // ignore getopt error
+  while ((opt = getopt_long(argc, argv, "i:r:h", longopts, &longindex)) !=
+         -1) {
+    switch (opt) {
+      case 'i':
+        instance_file = std::string(optarg);
+        break;
+      case 'r':
+        repetitions = std::atoi(optarg);
+        break;
+      case 'h':
+        printHelp();
+        return 0;
+      default:
+        break;
+    }
+  }
+
+  if (instance_file.length() == 0) {
+    std::cout << "specify instance file using -i [INSTANCE-FILE], e.g.,"
+              << std::endl;
+    std::cout << "> ./bench_astar -i ../sample-instance.txt" << std::endl;
+    return 0;
+  }
+
+  // set problem, no time limit
+  Problem P = Problem(instance_file);
+  P.setMaxCompTime(std::numeric_limits<int>::max() / 2);
+
+  AstarBenchmark solver(&P, repetitions);
+  solver.solve();
+
+  return 0;
+}
+
+void printHelp()
+{
+  std::cout << "\nUsage: ./bench_astar [OPTIONS]\n"
+            << "\n  -i --instance [FILE_PATH]     instance file path\n"
+            << "  -r --repetitions [INT]        repetitions of all agents\n"
+            << "  -h --help                     help\n"
+            << std::endl;
+}
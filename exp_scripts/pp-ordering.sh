@@ -0,0 +1,120 @@
+#!/bin/bash
+# compare ordering policies of PP: restarts until success and runtime
+# usage: bash pp-ordering.sh [time_limit(ms)] [scen_end]
+# instances: unzip ../instances.zip in the project directory beforehand
+source `dirname $0`/util.sh
+
+## args
+time_limit=${1:-10000}
+scen_end=${2:-25}
+scen_start=1
+
+PROJECT_DIR=`dirname $0`/..
+INSTANCE_DIR=$PROJECT_DIR/instances
+
+# map:agents
+benchmarks=(
+    "random-32-32-10:60"
+    "random-32-32-10:80"
+    "random-64-64-10:200"
+    "den520d:100"
+    "den520d:200"
+)
+
+orderings=(
+    "random"
+    "dist"
+    "dist-rand"
+    "congestion"
+    "congestion-rand"
+    "pressure"
+    "pressure-rand"
+)
+
+if [ ! -d $INSTANCE_DIR ]
+then
+    echo "unzip instances.zip in the project directory beforehand"
+    exit 1
+fi
+
+## create output directory
+EXP_DATE=`getDate`
+OUTPUT_DIR=$PROJECT_DIR/../data/$EXP_DATE/
+mkdir -p $OUTPUT_DIR
+RESULT_FILE=$OUTPUT_DIR/result.csv
+SUMMARY_FILE=$OUTPUT_DIR/summary.txt
+GIT_RECENT_COMMIT=`git log -1 --pretty=format:"%H"`
+
+## build
+(cd $PROJECT_DIR/build;
+ make app > /dev/null 2>&1;)
+
+## main
+echo "map,agents,scen,ordering,solved,restarts,comp_time" > $RESULT_FILE
+for benchmark in ${benchmarks[@]}
+do
+    map=${benchmark%:*}
+    agent_num=${benchmark#*:}
+    echo "map=${map}, agents=${agent_num}"
+    for ordering in ${orderings[@]}
+    do
+        scen=$scen_start
+        while [ $scen -lt `expr $scen_end + 1` ]
+        do
+            scen_file="${map}_${agent_num}agents_${scen}.txt"
+            plan_file=$OUTPUT_DIR/plan.txt
+            $PROJECT_DIR/build/app \
+                -i $INSTANCE_DIR/$scen_file \
+                -o $plan_file \
+                -s PP \
+                -T $time_limit \
+                -m 100000 \
+                -g $ordering > /dev/null
+            solved=`grep "^solved=" $plan_file | cut -d= -f2`
+            restarts=`grep "^repetation_PP=" $plan_file | cut -d= -f2`
+            comp_time=`grep "^comp_time=" $plan_file | cut -d= -f2`
+            echo "${map},${agent_num},${scen},${ordering},${solved},${restarts},${comp_time}" \
+                 >> $RESULT_FILE
+            scen=`expr $scen + 1`
+        done
+    done
+done
+rm -f $OUTPUT_DIR/plan.txt
+
+## summary: success rate, averages over solved instances
+awk -F, 'NR > 1 {
+    key = $1 "," $2 "," $4
+    if (!(key in cnt)) keys[++n] = key
+    ++cnt[key]
+    if ($5 == 1) { ++solved[key]; restarts[key] += $6; comp_time[key] += $7 }
+}
+END {
+    print "map,agents,ordering,success_rate,avg_restarts,avg_comp_time(ms)"
+    for (k = 1; k <= n; ++k) {
+        key = keys[k]
+        s = solved[key] + 0
+        avg_restarts = "-"
+        avg_comp_time = "-"
+        if (s != 0) {
+            avg_restarts = sprintf("%.1f", restarts[key] / s)
+            avg_comp_time = sprintf("%.0f", comp_time[key] / s)
+        }
+        printf "%s,%.2f,%s,%s\n", key, s / cnt[key], avg_restarts, avg_comp_time
+    }
+}' $RESULT_FILE > $SUMMARY_FILE
+cat $SUMMARY_FILE
+
+## create status file
+STATUS_FILE=$OUTPUT_DIR/status.txt
+{
+    echo start:$EXP_DATE
+    echo end:`date +%Y-%m-%d-%H-%M-%S`
+    echo used-commit:$GIT_RECENT_COMMIT
+    echo benchmarks:${benchmarks[@]}
+    echo orderings:${orderings[@]}
+    echo time_limit:$time_limit
+    echo scen_start:$scen_start
+    echo scen_end:$scen_end
+} > $STATUS_FILE
+
+echo "result -> ${OUTPUT_DIR}"
@@ -40,6 +40,7 @@ echo "- scen: from ${scen_start} to ${scen_end}"
 EXP_DATE=`getDate`
 OUTPUT_DIR=$PROJECT_DIR/../data/$EXP_DATE/
 mkdir -p $OUTPUT_DIR
+DIST_CACHE_DIR=$PROJECT_DIR/../data/dist_cache/
 
 ## build
 (cd $PROJECT_DIR/build;
@@ -60,7 +61,8 @@ do
                     -i $PROJECT_DIR/instances/$scen_file \
                     -o $OUTPUT_DIR/$plan_file \
                     -s $solver \
-                    -T $time_limit"
+                    -T $time_limit \
+                    -D $DIST_CACHE_DIR"
         eval $cmd
 
         # execution
@@ -16,6 +16,29 @@ private:
   int max_fragment_size;  // maximum fragment size
   static constexpr int DEFAULT_MAX_FRAGMENT_SIZE = -1;
 
+  // to manage potential deadlocks, reused over high-level nodes
+  // - agents are registered in the order of their ids
+  // - table_paths[0..k-1] are registered without potential deadlocks
+  // - agent k (partial_agent) may be registered until finding a deadlock
+  // - paths are compared by identity, see last_node for their lifetime
+  // - replacing only the changed agent via unregisterPath() would need all
+  //   paths registered with all their potential deadlocks, which is far
+  //   slower per node than rolling back the suffix from the changed agent
+  std::unique_ptr<TableFragment> table;
+  std::vector<const Path*> table_paths;  // nullptr -> not registered
+  std::vector<int> checkpoints;          // table checkpoint before each agent
+  int partial_agent;                     // -1 -> none
+
+  // directed edges used by the paths of the current node, for tie-breaking
+  // - edge (u, v) -> its index in the CSR view of the graph
+  std::vector<int> edge_usage;           // number of agents using each edge
+  std::vector<const Path*> usage_paths;  // paths reflected in edge_usage
+
+  // for profiling
+  int h_node_expanded;
+  int h_node_generated;
+  int head_on_cnt;  // f of the last expanded node
+
   // main
   void run();
 
@@ -30,38 +53,72 @@ private:
   using Constraint_p = std::shared_ptr<Constraint>;
   using Constraints = std::vector<Constraint_p>;
 
+  // paths of a high-level node, valid while the node is alive
+  using Paths = std::vector<const Path*>;
+
+  // persistent node, only the new constraint and the updated path are stored
+  // and the rest is shared with the ancestors
+  struct HighLevelNode;
+  using HighLevelNode_p = std::shared_ptr<HighLevelNode>;
   struct HighLevelNode {
-    Plan paths;               // solution
-    Constraints constraints;  // constraints
+    HighLevelNode_p parent;   // nullptr -> root
+    Constraint_p constraint;  // added constraint, nullptr -> root
+    Path path;                // updated path of constraint->agent
+    int depth;                // #(constraints)
     int f;                    // #(head-on collisions)
             // 用于dbs目标函数，表示当前solution中的swap冲突个数
     bool valid;  // false -> no path is found
 
-    HighLevelNode() : constraints({}), f(0), valid(true) {}
+    HighLevelNode()
+        : parent(nullptr), constraint(nullptr), depth(0), f(0), valid(true)
+    {
+    }
   };
-  using HighLevelNode_p = std::shared_ptr<HighLevelNode>;
   using HighLevelNodes = std::vector<HighLevelNode_p>;
 
+  Plan initial_paths;  // paths of the root, not reallocated during search
+
+  // last expanded node, its ancestors own table_paths and usage_paths
+  HighLevelNode_p last_node;
+
+  // collect the paths of the node from its ancestors
+  void getPaths(HighLevelNode_p n, Paths& paths);
+
   // setup initial node
   HighLevelNode_p getInitialNode();
 
   // invoke high-level node
-  HighLevelNode_p invoke(HighLevelNode_p n, Constraint_p c);
+  // paths are those of n, restored before return
+  HighLevelNode_p invoke(HighLevelNode_p n, Constraint_p c, Paths& paths);
 
-  // low-level search
+  // low-level search, paths of other agents are taken from edge_usage
   Path getConstrainedPath(const int id, HighLevelNode_p node);
   Path getConstrainedPath(const int id, Constraints& _constraints);
 
-  // get constraints
-  Constraints getConstraints(const Plan& paths);
+  // get constraints, the table is updated from the first changed path
+  Constraints getConstraints(const Paths& paths);
+
+  // unregister agents whose ids are larger than or equal to k, LIFO
+  void rollbackTable(const int k);
 
-  // count #(head-on collisions)
-  int countsSwapConlicts(const Plan& paths);
+  // manage edge usage, return the change of #(head-on collisions)
+  void setupEdgeUsage();
+  int getEdgeIndex(Node* const u, Node* const v) const;
+  int addEdgeUsage(const Path& path, const int delta);
+  int updateEdgeUsage(const int id, const Path* path);
+  void updateEdgeUsage(const Paths& paths);
+
+protected:
+  void makeLogBasicInfo(std::ofstream& log);
 
 public:
   DBS(Problem* _P);
   ~DBS();
 
+  int getHighLevelExpanded() const { return h_node_expanded; }
+  int getHeadOnCollisions() const { return head_on_cnt; }
+  Plan getLastNodePaths();  // e.g., to inspect interrupted search
+
   void setParams(int argc, char* argv[]);
   static void printHelp();
 };
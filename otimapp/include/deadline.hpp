@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <limits>
+
+#include "util.hpp"
+
+/*
+deadline of computation, checked in hot loops
+- the clock is read only once per check_interval units of work; callers
+  weight expensive steps, e.g., by fragments created, and outer loops of
+  solvers use the exact check
+- once expired, stays expired
+- cancel() is allowed from other threads, also before set()
+- cancelling the parent cancels its children, e.g., per-thread deadlines
+*/
+class Deadline
+{
+public:
+  static constexpr int DEFAULT_CHECK_INTERVAL = 256;
+
+private:
+  Time::time_point t_end;
+  bool unlimited;
+  std::atomic<bool> cancelled;
+  const Deadline* parent;  // nullptr -> none
+  int check_interval;      // units of work between clock reads
+
+  mutable int countdown;       // until next clock read
+  mutable bool expired_;       // sticky
+  mutable uint64_t clock_cnt;  // number of clock reads, for profiling
+
+  bool readClock() const
+  {
+    ++clock_cnt;
+    countdown = check_interval;
+    if (!unlimited && Time::now() >= t_end) expired_ = true;
+    return expired_;
+  }
+
+public:
+  Deadline()
+      : unlimited(true),
+        cancelled(false),
+        parent(nullptr),
+        check_interval(DEFAULT_CHECK_INTERVAL),
+        countdown(0),
+        expired_(false),
+        clock_cnt(0)
+  {
+  }
+
+  // time_limit < 0 -> unlimited
+  void set(const Time::time_point& t_start, const int time_limit)
+  {
+    unlimited = time_limit < 0;
+    t_end = t_start + std::chrono::milliseconds(std::max(0, time_limit));
+    countdown = 0;
+    expired_ = false;
+  }
+
+  void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+  bool isCancelled() const
+  {
+    return cancelled.load(std::memory_order_relaxed) ||
+           (parent != nullptr && parent->isCancelled());
+  }
+  void setParent(const Deadline* _parent) { parent = _parent; }
+
+  // amortized check, work: rough cost of the step since the last call
+  bool expired(const int work = 1) const
+  {
+    if (expired_ || isCancelled()) return true;
+    countdown -= work;
+    return countdown <= 0 && readClock();
+  }
+
+  // exact check, reads the clock
+  bool expiredNow() const { return isCancelled() || readClock(); }
+
+  int getRemainedTime() const
+  {
+    if (unlimited) return std::numeric_limits<int>::max();
+    const auto rest = std::chrono::duration_cast<std::chrono::milliseconds>(
+        t_end - Time::now());
+    return std::max(0, (int)rest.count());
+  }
+
+  void setCheckInterval(const int interval) { check_interval = interval; }
+  uint64_t getClockCnt() const { return clock_cnt; }
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <limits>
+#include <string>
+
+#include "graph_view.hpp"
+
+/*
+distance tables from goals, for the heuristics of A-star search
+- computed by BFS when first used
+- agents sharing a goal share one table
+- stored in 16 bits unless the graph has too many nodes; distances are
+  bounded by the number of existing nodes, not by the number of cells
+- on 4-connected grids, BFS expands whole frontiers as row bitboards
+- with a memory limit, least recently used tables are dropped and
+  computed again when necessary
+- optionally, tables are stored in a directory as raw binary files,
+  keyed by the hash of the graph and the goal id, and loaded via mmap
+  instead of BFS in later runs
+*/
+class DistanceTable
+{
+public:
+  using Dist = uint16_t;
+  static constexpr Dist UNREACHABLE = std::numeric_limits<Dist>::max();
+
+private:
+  const GraphView* const G;
+  const int nodes_size;
+  const bool compact;  // true -> 16 bits, false -> int
+
+  std::vector<int> agent_table;  // agent -> table, i.e., goal
+  std::vector<Node*> goals;      // table -> goal
+
+  // cached tables, empty -> not computed
+  mutable std::vector<std::vector<Dist>> tables;
+  mutable std::vector<std::vector<int>> tables_wide;  // when not compact
+
+  // LRU, stamped by the number of computations when used
+  mutable std::vector<uint64_t> last_used;
+  mutable uint64_t clock;
+
+  size_t max_bytes;               // 0 -> unlimited
+  mutable size_t used_bytes;      // memory of cached tables
+  mutable int computed_cnt;       // number of BFS, including recomputation
+  mutable std::vector<int> OPEN;  // buffer of BFS
+
+  // bitboard of passable cells, one padding word per row and one padding
+  // row above and below; empty -> not a 4-connected grid
+  std::vector<uint64_t> passable;
+  int grid_width;
+  int words_per_row;
+
+  // on-disk cache
+  std::string cache_dir;   // empty -> not used
+  uint64_t graph_hash;     // over nodes and their neighbors
+  mutable int cache_hits;  // tables loaded from the cache
+
+  static constexpr uint32_t CACHE_MAGIC = 0x5444544f;  // "OTDT"
+  struct CacheHeader {
+    uint32_t magic;
+    uint32_t elem_size;  // bytes of one entry
+    uint64_t graph_hash;
+    uint64_t nodes_size;
+    uint64_t goal;  // node id
+  };
+
+  // true when distances fit in 16 bits with UNREACHABLE reserved
+  static bool isCompactGraph(const GraphView* G);
+
+  void compute(const int k) const;
+  template <class T>
+  void bfs(Node* const g, std::vector<T>& table, std::vector<int>& open) const;
+  template <class T>
+  void bfsGrid(Node* const g, std::vector<T>& table) const;
+  template <class T>
+  void search(const int k, std::vector<T>& table,
+              std::vector<int>& open) const;
+  void setupBitboard();
+  void release(const int k) const;
+  size_t tableBytes() const;
+  void* tableData(const int k) const;
+
+  // return true when the table is loaded from the cache
+  bool loadCache(const int k) const;
+  void saveCache(const int k) const;
+  std::string getCacheFile(const int k) const;
+  uint64_t getGraphHash() const;
+
+public:
+  DistanceTable(const GraphView* _G, const std::vector<Node*>& agent_goals);
+
+  // distance from v to the goal of agent i, nodes_size when unreachable
+  // v is the index in the graph view, i.e., node id unless renumbered
+  int get(const int i, const int v) const
+  {
+    const int k = agent_table[i];
+    if (compact) {
+      if (tables[k].empty()) compute(k);
+      if (max_bytes > 0) last_used[k] = clock;
+      const Dist d = tables[k][v];
+      return d == UNREACHABLE ? nodes_size : d;
+    }
+    if (tables_wide[k].empty()) compute(k);
+    if (max_bytes > 0) last_used[k] = clock;
+    return tables_wide[k][v];
+  }
+
+  // compute tables of all goals as long as the memory limit allows,
+  // BFS runs are distributed over the given number of threads
+  void computeAll(const int threads = 1);
+
+  // memory limit of cached tables, 0 -> unlimited
+  void setMaxBytes(const size_t _max_bytes) { max_bytes = _max_bytes; }
+
+  // directory of the on-disk cache, created when missing
+  void setCacheDir(const std::string& _cache_dir);
+
+  int getTablesSize() const { return goals.size(); }
+  bool isCompact() const { return compact; }
+  int getComputedCnt() const { return computed_cnt; }
+  // true -> get() only reads, safe from multiple threads
+  bool isReadOnly() const;
+  int getCacheHits() const { return cache_hits; }
+  size_t getUsedBytes() const { return used_bytes; }
+};
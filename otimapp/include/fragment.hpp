@@ -1,16 +1,121 @@
 #pragma once
+#include <cstdint>
 #include <graph.hpp>
+#include <memory>
 #include <queue>
 
+#include "deadline.hpp"
+
 /*
 a pair of two lists: agents & path
+- path: node ids, head -> tail, always one longer than agents
+- both lists are contiguous, stored inline for small fragments and in the
+  payload buffer of the arena otherwise
 */
 struct Fragment {
-  std::deque<Node*>
-      path;  // head -> tail, for the convenience, I did not use "clocks"
-  std::deque<int> agents;  // a_i, a_j, ..., a_l
+  static constexpr int INLINE_SIZE = 3;  // max agents stored inline
+
+  int size;      // number of agents
+  int capacity;  // max number of agents storable without new payload
+  int* path;     // head -> tail, for the convenience, I did not use "clocks"
+  int* agents;   // a_i, a_j, ..., a_l
+  int inline_buf[2 * INLINE_SIZE + 1];
+  bool removed;  // true -> unregistered, waiting for reuse
+
+  // bloom-style signatures, disjoint masks -> disjoint sets
+  uint64_t agent_mask;
+  uint64_t node_mask;
+  uint64_t hash;  // over ordered path and set of agents
+
+  Fragment()
+      : size(0),
+        capacity(0),
+        path(nullptr),
+        agents(nullptr),
+        removed(false),
+        agent_mask(0),
+        node_mask(0),
+        hash(0)
+  {
+  }
+
+  int head() const { return path[0]; }
+  int tail() const { return path[size]; }
+  bool hasAgent(const int i) const;
+
+  // check common agents or nodes, exact only when signatures overlap
+  bool shareAgents(const Fragment* c) const;
+  bool shareNodes(const Fragment* c) const;
+
+  // same path and same set of agents
+  bool isSame(const int* _path, const int* _agents, const int _size) const;
+
+  // compute signatures from the lists
+  void setupSignatures();
+  static uint64_t getHash(const int* path, const int* agents, const int size);
 
-  Fragment() {}
+  static uint64_t agentBit(const int i) { return uint64_t(1) << (i & 63); }
+  static uint64_t nodeBit(const int v)
+  {
+    return uint64_t(1) << ((uint64_t(v) * 0x9E3779B97F4A7C15ULL) >> 58);
+  }
+};
+
+/*
+slab allocator of fragments
+- fragments are handed out from fixed-size slabs in order
+- payloads of large fragments are taken from chunks of node/agent ids
+- released fragments are reused first, their payloads when large enough
+- reset() releases all fragments at once; slabs are kept and reused
+*/
+struct FragmentArena {
+  static constexpr int SLAB_SIZE = 1024;
+  static constexpr int CHUNK_SIZE = 1 << 16;
+  std::vector<std::unique_ptr<Fragment[]>> slabs;
+  int used;  // number of fragments handed out
+  std::vector<Fragment*> released;
+  std::vector<std::unique_ptr<int[]>> chunks;
+  std::vector<int> chunk_sizes;
+  int chunk_index;  // current chunk
+  int chunk_used;   // used size of the current chunk
+
+  FragmentArena() : used(0), chunk_index(0), chunk_used(0) {}
+
+  // return fragment with enough storage for the given number of agents
+  Fragment* allocate(const int size);
+  void release(Fragment* c) { released.push_back(c); }
+  void reset();
+
+private:
+  int* allocatePayload(const int n);
+};
+
+/*
+open-addressing index of fragments by their hash, for duplication check
+*/
+struct FragmentIndex {
+  std::vector<Fragment*> slots;  // size is power of two, nullptr -> empty
+  int cnt;                       // number of registered fragments
+
+  // counters, kept over clear()
+  uint64_t probes;      // number of lookups
+  uint64_t hits;        // lookups finding duplication
+  uint64_t collisions;  // same hash but different fragments
+
+  FragmentIndex();
+
+  // return registered fragment identical to the given one, or nullptr
+  Fragment* find(const std::vector<int>& path, const std::vector<int>& agents,
+                 const uint64_t hash);
+  void insert(Fragment* c);
+  void erase(Fragment* c);
+  void clear();
+
+private:
+  int used_slots;  // registered fragments and tombstones
+  static Fragment TOMBSTONE;
+
+  void rehash();
 };
 
 struct TableFragment {
@@ -21,37 +126,73 @@ struct TableFragment {
   - table to:   stores all the fragments ending at the vertex
   - A fragment is registered in both tables
   */
-  std::vector<std::vector<Fragment*>> t_from;  // table from
-  std::vector<std::vector<Fragment*>> t_to;    // table to
+  std::vector<std::vector<Fragment*>> t_from;   // table from
+  std::vector<std::vector<Fragment*>> t_to;     // table to
+  std::vector<std::vector<Fragment*>> t_agent;  // fragments of each agent
+  std::vector<Fragment*> cycles;                // potential deadlocks
+  std::vector<Fragment*> history;               // in creation order
   Graph* G;
   int max_fragment_size;  // maximum fragment size
 
+  FragmentArena arena;             // storage of all fragments
+  std::vector<int> used_nodes;     // keys possibly with non-empty entries
+  std::vector<bool> is_used_node;  // whether the key is in used_nodes
+
+  // xor of hashes of fragments in t_from and t_to of the key,
+  // depends only on the registered fragments, not on the history
+  std::vector<uint64_t> node_fingerprint;
+  FragmentIndex index;             // for duplication check
+
+  // candidate of new fragment, buffers are reused
+  std::vector<int> cand_path;
+  std::vector<int> cand_agents;
+
   TableFragment(Graph* _G, const int _max_fragment_size = -1);
   ~TableFragment();
 
+  // remove all fragments, memory is kept for the next registration
+  void clear();
+
   // check duplication
-  bool existDuplication(const std::deque<Node*>& path,
-                        const std::deque<int>& agents);
+  bool existDuplication(const std::vector<int>& path,
+                        const std::vector<int>& agents, const uint64_t hash);
 
   // branching, valid only when max_fragment_size > 0
-  bool isValidTopologyCondition(const std::deque<Node*>& path) const;
+  bool isValidTopologyCondition(const std::vector<int>& path) const;
 
   // create new entry
-  Fragment* createNewFragment(const std::deque<Node*>& path,
-                              const std::deque<int>& agents);
+  Fragment* createNewFragment(const std::vector<int>& path,
+                              const std::vector<int>& agents,
+                              const uint64_t hash);
 
-  // return potential deadlock if exists
-  Fragment* getPotentialDeadlockIfExist(const int id, Node* head,
-                                        Fragment* c_base, Node* tail);
-  Fragment* getPotentialDeadlockIfExist(const std::deque<Node*>& path,
-                                        const std::deque<int>& agents);
+  // return potential deadlock if exists, head & tail are node ids
+  Fragment* getPotentialDeadlockIfExist(const int id, const int head,
+                                        Fragment* c_base, const int tail);
+  Fragment* getPotentialDeadlockIfExist(const std::vector<int>& path,
+                                        const std::vector<int>& agents);
 
   // return deadlock or nullptr
   // force = false -> return when finding first cycle, false -> register all
   // info
+  // stop with nullptr when the deadline expires
   Fragment* registerNewPath(const int id, const Path path,
                             const bool force = false,
-                            const int time_limit = -1);
+                            const Deadline* deadline = nullptr);
+
+  // remove all fragments including the agent, e.g., to replace its path
+  // - history shrinks, checkpoints taken before the call become invalid
+  void unregisterPath(const int id);
+
+  // remove all fragments created after the checkpoint, in LIFO order
+  // - a checkpoint is the size of history, valid until unregisterPath()
+  //   or clear() is called; do not mix them with rollback
+  int getCheckpoint() const { return history.size(); }
+  void rollback(const int checkpoint);
+
+  // fingerprint of fragments at the nodes,
+  // the same value -> the same fragments with high probability
+  uint64_t getFingerprint(const std::vector<int>& nodes) const;
+  void updateFingerprint(Fragment* c);
 
   // print registered info
   void println();
@@ -0,0 +1,89 @@
+#pragma once
+#include <graph.hpp>
+#include <string>
+
+/*
+read-only snapshot of the graph in CSR format, for hot loops
+- nodes are addressed by index, equal to node id unless renumbered
+- neighbors of v: adj[offsets[v]], ..., adj[offsets[v+1]-1],
+  in the same order as Node::neighbor
+- the index in adj also identifies a directed edge
+- grid coordinates are available when the graph is a grid,
+  i.e., id = y * width + x
+- on grids, nodes can be renumbered along a space-filling curve so that
+  arrays indexed by nodes have better locality; node ids of Node* are
+  untouched, hence results are not affected
+- only structures accessed through the view follow the renumbering,
+  i.e., the adjacency, CLOSE lists of A*, distance tables and edge usage;
+  TableFragment, table_goals of Solver and Execution are still keyed by
+  Node::id, since they are reached from Node* in search callbacks or work
+  on Graph directly (fragment paths are node ids, also used by DBS
+  constraints and the topology check via Graph::getPath); keying them by
+  index would add an id -> index lookup to every access
+*/
+class GraphView
+{
+public:
+  enum Order { ROW_MAJOR, MORTON, HILBERT };
+
+  // contiguous neighbor indexes of one node
+  struct Neighbors {
+    const int* const first;
+    const int size_;
+    const int* begin() const { return first; }
+    const int* end() const { return first + size_; }
+    int size() const { return size_; }
+    int operator[](const int j) const { return first[j]; }
+  };
+
+private:
+  const int nodes_size;
+  Order order;
+  std::vector<int> offsets;  // v -> start of its neighbors in adj
+  std::vector<int> adj;      // neighbor indexes
+  std::vector<Node*> nodes;  // index -> node, nullptr when not existing
+  std::vector<int> ids;      // index -> id, empty -> identical
+  std::vector<int> indexes;  // id -> index, empty -> identical
+  int width;                 // 0 -> not a grid
+  int height;
+
+  // return position along the curve
+  static uint64_t getMortonKey(const int x, const int y);
+  static uint64_t getHilbertKey(const int x, const int y, const int n);
+
+public:
+  GraphView(Graph* G, const Order _order = ROW_MAJOR);
+
+  int getNodesSize() const { return nodes_size; }
+  bool existNode(const int v) const { return nodes[v] != nullptr; }
+  Node* getNode(const int v) const { return nodes[v]; }
+
+  // conversion between node ids and indexes
+  Order getOrder() const { return order; }
+  int getIndex(const int id) const
+  {
+    return indexes.empty() ? id : indexes[id];
+  }
+  int getIndex(const Node* v) const { return getIndex(v->id); }
+  int getId(const int v) const { return ids.empty() ? v : ids[v]; }
+
+  int getDegree(const int v) const { return offsets[v + 1] - offsets[v]; }
+  Neighbors getNeighbors(const int v) const
+  {
+    return Neighbors{adj.data() + offsets[v], getDegree(v)};
+  }
+
+  // directed edges, u -> v, -1 when not adjacent
+  int getEdgesSize() const { return adj.size(); }
+  int getEdgeIndex(const int u, const int v) const;
+
+  // grid coordinates
+  bool isGrid() const { return width > 0; }
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  int getX(const int v) const { return getId(v) % width; }
+  int getY(const int v) const { return getId(v) / width; }
+
+  static Order getOrderByName(const std::string& name);
+  static std::string getOrderName(const Order order);
+};
@@ -53,9 +53,11 @@
     for (int i = 0; i < num_agents; ++i) {
       Node* v_i_t = configs[t][i];
       Node* v_i_t_1 = configs[t - 1][i];
-      Nodes cands = v_i_t_1->neighbor;
-      cands.push_back(v_i_t_1);
-      if (!inArray(v_i_t, cands)) return false;
+      auto GV = P->getGraphView();
+      if (v_i_t != v_i_t_1 &&
+          GV->getEdgeIndex(GV->getIndex(v_i_t_1), GV->getIndex(v_i_t)) < 0) {
+        return false;
+      }
       // see conflicts
       for (int j = i + 1; j < num_agents; ++j) {
         Node* v_j_t = configs[t][j];
@@ -18,8 +18,90 @@ private:
   int max_fragment_size;  // maximum fragment size
   static constexpr int DEFAULT_MAX_FRAGMENT_SIZE = -1;
 
+  // to manage potential deadlocks, reused over iterations
+  std::unique_ptr<TableFragment> table;
+
+  int search_cnt;  // number of single-agent searches, including cache hits
+
+  // priority orders of agents, a larger key is planned earlier
+  // - RANDOM: uniform shuffle
+  // - DIST: distance from start to goal
+  // - CONGESTION: goals of others on shortest paths, avoided by the agent
+  // - PRESSURE: fragments at start and goal, accumulated over sequential
+  //   iterations; the first iteration and parallel restarts are random
+  // ties are broken randomly, randomized variants (-rand) sample orders
+  // weighted by keys, e.g., to diversify restarts
+  enum Ordering { RANDOM, DIST, CONGESTION, PRESSURE };
+  Ordering ordering;
+  bool ordering_randomized;
+  std::vector<double> order_keys;
+  static Ordering getOrderingByName(const std::string& name);
+  static bool isRandomizedOrdering(const std::string& name);
+  static std::string getOrderingName(const Ordering ordering);
+  void setupOrderKeys();
+  void updatePressure(const TableFragment& table);
+  template <class URBG>
+  void setOrder(std::vector<int>& id_list, URBG& rng);
+  std::vector<int> getIterationOrder(const int iter, SplitMix64& rng);
+
+  // memoized paths over restarts
+  // - the search result only depends on fragments at the created nodes,
+  //   i.e., t_to of expanded nodes and t_from of nodes in OPEN
+  // - reused while the fingerprint of fragments at those nodes is the same
+  // - in restarts with derived seeds, tie-breaking of each agent is seeded
+  //   by its id, so that a cached path equals the one searched now and
+  //   results do not depend on which iterations a worker ran before
+  struct PathCache {
+    Path path;               // empty -> nothing cached
+    std::vector<int> nodes;  // created by the search
+    uint64_t fingerprint;
+  };
+  using PathCaches = std::vector<PathCache>;
+  bool use_path_cache;
+  PathCaches path_cache;
+  int path_cache_hits;
+  Path getCachedPath(SearchWorkspace& W, const int id, const Plan& paths,
+                     TableFragment& table, PathCaches& cache, int& hits);
+
+  // how to restart after a failure
+  // - SHUFFLE: discard all paths, replan with a reshuffled order
+  // - PREFIX: promote the failed agent to the middle of the prefix, roll
+  //   the table back to there and replan only the following agents
+  enum RestartStrategy { SHUFFLE, PREFIX };
+  RestartStrategy restart_strategy;
+  static RestartStrategy getRestartStrategyByName(const std::string& name);
+  static std::string getRestartStrategyName(const RestartStrategy strategy);
+
+  // restarts with seeds derived from iteration numbers
+  // - used when threads > 1 or restart_from > 0
+  // - iterations are independent, run in parallel by workers
+  // - the first success cancels the others
+  // - rerun with -a [restart_iter] in one thread to reproduce the result
+  int restart_from;  // first iteration number, 0 -> sequential seeds
+  static constexpr int DEFAULT_RESTART_FROM = 0;
+  int restart_iter;  // iteration found the solution, -1 -> none
+  int restart_workers;
+  struct Worker {
+    SearchWorkspace workspace;
+    Deadline deadline;  // child of the solver's deadline
+    std::unique_ptr<TableFragment> table;
+    Plan solution;
+    PathCaches path_cache;
+    int itr_cnt = 0;
+    int search_cnt = 0;
+    int path_cache_hits = 0;
+    int elapsed_time_pathfinding = 0;
+    int elapsed_time_deadlock_detection = 0;
+    int elapsed_time_table_release = 0;
+  };
+
   // main
   void run();
+  void runRestarts();
+  void runPrefixRestarts();
+  bool runIteration(const int iter, Worker& w);
+  uint64_t getIterationSeed(const int iter) const;
+  uint64_t getAgentSeed(const int id) const;
 
 protected:
   void makeLogBasicInfo(std::ofstream& log);
@@ -28,6 +110,14 @@ public:
   PP(Problem* _P);
   ~PP();
 
+  int getRestartIteration() const { return restart_iter; }
+  int getPathCacheHits() const { return path_cache_hits; }
+
+  // keys of the ordering, set by solve(); order of restarts with derived
+  // seeds from the current keys, planned from the front
+  const std::vector<double>& getOrderKeys() const { return order_keys; }
+  std::vector<int> getIterationOrder(const int iter);
+
   void setParams(int argc, char* argv[]);
   static void printHelp();
 };
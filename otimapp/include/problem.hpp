@@ -3,6 +3,7 @@
 #include <random>
 
 #include "default_params.hpp"
+#include "graph_view.hpp"
 #include "util.hpp"
 
 using Config = std::vector<Node*>;  // < loc_0[t], loc_1[t], ... >
@@ -15,6 +16,7 @@ class Problem
 private:
   std::string instance;  // instance name
   Graph* G;              // graph
+  GraphView* GV;         // CSR view of the graph
   int seed;              // seed
   std::mt19937* MT;      // randomness
   Config config_s;       // initial configuration
@@ -38,6 +40,7 @@ public:
   ~Problem();
 
   Graph* getG() { return G; }
+  const GraphView* getGraphView() const { return GV; }
   int getNum() { return num_agents; }
   std::mt19937* getMT() { return MT; }
   Node* getStart(int i) const;  // return start of a_i
@@ -51,6 +54,9 @@ public:
 
   void setMaxCompTime(const int t) { max_comp_time = t; }
 
+  // renumber nodes of the graph view, call before creating solvers
+  void setNodeOrder(const GraphView::Order order);
+
   // used when making new instance file
   void makeScenFile(const std::string& output_file);
 };
@@ -1,11 +1,14 @@
 #pragma once
 #include <getopt.h>
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <queue>
 #include <unordered_map>
 
+#include "deadline.hpp"
+#include "distance_table.hpp"
 #include "fragment.hpp"
 #include "problem.hpp"
 #include "util.hpp"
@@ -13,14 +16,16 @@
 class MinimumSolver
 {
 protected:
-  std::string solver_name;  // solver name
-  Problem* const P;         // problem instance
-  Graph* const G;           // graph
-  std::mt19937* const MT;   // for randomness
-  const int max_comp_time;  // time limit for computation, ms
-  Plan solution;            // solution
-  bool solved;              // success -> true, failed -> false (default)
-  bool unsolvable;          // default: false, true -> instance is unsolvable
+  std::string solver_name;    // solver name
+  Problem* const P;           // problem instance
+  Graph* const G;             // graph
+  const GraphView* const GV;  // CSR view of the graph, for hot loops
+  std::mt19937* const MT;     // for randomness
+  const int max_comp_time;    // time limit for computation, ms
+  Plan solution;              // solution
+  bool solved;                // success -> true, failed -> false (default)
+  bool unsolvable;            // default: false, true -> instance is unsolvable
+  Deadline deadline;          // set when starting, by max_comp_time
 
 private:
   int comp_time;             // computation time
@@ -42,9 +47,13 @@ public:
   // getter
   Plan getSolution() const { return solution; };
   bool succeed() const { return solved; };
+  bool isUnsolvable() const { return unsolvable; };
   std::string getSolverName() const { return solver_name; };
   int getCompTime() const { return comp_time; }
   int getSolverElapsedTime() const;  // get elapsed time from start
+
+  // stop solving as soon as possible, callable from other threads
+  void cancel() { deadline.cancel(); }
 };
 
 // -----------------------------------------------
@@ -58,8 +67,10 @@ private:
 
   // distance to goal
 protected:
-  using DistanceTable = std::vector<std::vector<int>>;  // [agent][node_id]
-  DistanceTable distance_table;                         // distance table
+  DistanceTable distance_table;  // lazy, shared by agents with the same goal
+  int max_distance_table_mb;     // memory limit of distance tables, 0 -> none
+  int threads;  // > 1 -> compute distance tables in advance, in parallel
+  std::string distance_table_cache;  // directory of on-disk cache, or empty
 
   // goal location
 protected:
@@ -69,6 +80,7 @@ protected:
 protected:
   int elapsed_time_pathfinding;
   int elapsed_time_deadlock_detection;
+  int elapsed_time_table_release;  // included in deadlock detection
 
   // -------------------------------
   // main
@@ -81,7 +93,7 @@ protected:
   // utilities for time
 public:
   int getRemainedTime() const;  // get remained time
-  bool overCompTime() const;    // check time limit
+  bool overCompTime() const;    // check time limit, reads the clock
 
   // -------------------------------
   // utilities for debug
@@ -106,6 +118,7 @@ public:
 protected:
   virtual void makeLogBasicInfo(std::ofstream& log);
   void makeLogSolution(std::ofstream& log);
+  void makeLogFragmentIndex(std::ofstream& log, const TableFragment* table);
 
   // -------------------------------
   // utilities for solver options
@@ -124,10 +137,15 @@ protected:
   // -------------------------------
   // utilities for distance
 public:
-  int pathDist(const int i,
-               Node* const s) const;  // get path distance between s -> g_i
-  int pathDist(const int i) const;    // get path distance between s_i -> g_i
-  void createDistanceTable();         // compute distance table
+  int pathDist(const int i, Node* const s) const
+  {
+    return distance_table.get(i, GV->getIndex(s));  // path distance s -> g_i
+  }
+  int pathDist(const int i, const int v) const
+  {
+    return distance_table.get(i, v);  // same as above, by index of GV
+  }
+  int pathDist(const int i) const;  // get path distance between s_i -> g_i
   // use grid-pathfinding
   int pathDist(Node* const s, Node* const g) const { return G->pathDist(s, g); }
 
@@ -147,18 +165,256 @@ public:
     AstarNode* p;  // parent（上一个node）
   };
   using AstarNodes = std::vector<AstarNode*>;
+
+  // storage of A-star search reused over calls
+  // - nodes are taken from fixed-size blocks, released all at once
+  // - CLOSE is stamped by the search number, no need to clear it
+  // - one workspace per thread
+  struct SearchWorkspace {
+    static constexpr int BLOCK_SIZE = 4096;
+    std::vector<std::unique_ptr<AstarNode[]>> blocks;
+    int used;                         // number of nodes handed out
+    AstarNodes OPEN;                  // binary heap
+    std::vector<AstarNodes> buckets;  // bucket queue, [key] -> binary heap
+    int bucket_cursor;                // no nodes in buckets below it
+    int bucket_max;                   // max used key
+    int bucket_nodes;                 // number of nodes in buckets
+    std::vector<unsigned int> CLOSE;  // == generation -> closed
+    unsigned int generation;          // current search number
+    SplitMix64 rng;                   // randomize order of neighbors
+    std::vector<int> order;           // buffer of the random order
+    const Deadline* deadline;         // time limit of searches
+    uint64_t expanded;                // number of expanded nodes
+
+    SearchWorkspace(const Deadline* _deadline = nullptr)
+        : used(0),
+          bucket_cursor(0),
+          bucket_max(-1),
+          bucket_nodes(0),
+          generation(0),
+          deadline(_deadline),
+          expanded(0)
+    {
+    }
+
+    // prepare the next search
+    void reset(const int nodes_size);
+    AstarNode* createNewNode(Node* v, const int g, const int f, AstarNode* p);
+    bool isClosed(const int id) const { return CLOSE[id] == generation; }
+    void close(const int id) { CLOSE[id] = generation; }
+    // node ids of all nodes created in the last search, CLOSE is reused
+    void getCreatedNodes(std::vector<int>& ids);
+  };
+  SearchWorkspace workspace;
+
+  // OPEN list: binary heap, the order is given by compare
+  template <class CompareFunc>
+  struct BinaryHeap {
+    AstarNodes& heap;
+    CompareFunc compare;
+
+    bool empty() const { return heap.empty(); }
+    void push(AstarNode* n)
+    {
+      heap.push_back(n);
+      std::push_heap(heap.begin(), heap.end(), compare);
+    }
+    AstarNode* pop()
+    {
+      std::pop_heap(heap.begin(), heap.end(), compare);
+      auto n = heap.back();
+      heap.pop_back();
+      return n;
+    }
+  };
+
+  // OPEN list: buckets by non-negative integer key (smaller is first),
+  // each bucket is a binary heap by compare, which must agree with the key
+  template <class KeyFunc, class CompareFunc>
+  struct BucketQueue {
+    SearchWorkspace& W;
+    KeyFunc key;
+    CompareFunc compare;
+
+    bool empty() const { return W.bucket_nodes == 0; }
+    void push(AstarNode* n)
+    {
+      const int k = key(n);
+      if (k >= (int)W.buckets.size()) W.buckets.resize(k + 1);
+      auto& bucket = W.buckets[k];
+      bucket.push_back(n);
+      std::push_heap(bucket.begin(), bucket.end(), compare);
+      W.bucket_cursor = std::min(W.bucket_cursor, k);
+      W.bucket_max = std::max(W.bucket_max, k);
+      ++W.bucket_nodes;
+    }
+    AstarNode* pop()
+    {
+      while (W.buckets[W.bucket_cursor].empty()) ++W.bucket_cursor;
+      auto& bucket = W.buckets[W.bucket_cursor];
+      std::pop_heap(bucket.begin(), bucket.end(), compare);
+      auto n = bucket.back();
+      bucket.pop_back();
+      --W.bucket_nodes;
+      return n;
+    }
+  };
+
+  bool use_bucket_queue;  // true -> bucket queue for OPEN when available
+
   using CheckInvalidMove = std::function<bool(Node*, Node*)>;
   using CompareAstarNodes = std::function<bool(AstarNode*, AstarNode*)>;
   static CompareAstarNodes compareAstarNodesDefault;
 
   // implementation of A-star search
+  // - checkInvalidMove(child, parent): true -> prohibited move
+  // - compare(a, b): true -> b is expanded before a
+  // - key(a): primary key of compare, for bucket queue
+  // the template version is inlined, use it in hot loops
+  // versions without workspace use the solver's own one
+  template <class CheckInvalidMoveFunc, class OpenList>
+  Path getPathWithOpenList(SearchWorkspace& W, const int id,
+                           CheckInvalidMoveFunc&& checkInvalidMove,
+                           OpenList&& OPEN);
+  template <class CheckInvalidMoveFunc, class CompareFunc>
+  Path getPath(SearchWorkspace& W, const int id,
+               CheckInvalidMoveFunc&& checkInvalidMove, CompareFunc&& compare);
+  template <class CheckInvalidMoveFunc, class CompareFunc, class KeyFunc>
+  Path getPath(SearchWorkspace& W, const int id,
+               CheckInvalidMoveFunc&& checkInvalidMove, CompareFunc&& compare,
+               KeyFunc&& key);
+  template <class CheckInvalidMoveFunc, class CompareFunc>
+  Path getPath(const int id, CheckInvalidMoveFunc&& checkInvalidMove,
+               CompareFunc&& compare)
+  {
+    return getPath(workspace, id, checkInvalidMove, compare);
+  }
+  template <class CheckInvalidMoveFunc, class CompareFunc, class KeyFunc>
+  Path getPath(const int id, CheckInvalidMoveFunc&& checkInvalidMove,
+               CompareFunc&& compare, KeyFunc&& key)
+  {
+    return getPath(workspace, id, checkInvalidMove, compare, key);
+  }
   Path getPath(const int id, CheckInvalidMove checkInvalidMove,
                CompareAstarNodes compare = compareAstarNodesDefault);
   // prioritized planning
-  Path getPrioritizedPath(const int id, const Plan& paths,
+  Path getPrioritizedPath(SearchWorkspace& W, const int id, const Plan& paths,
                           TableFragment& table);
+  Path getPrioritizedPath(const int id, const Plan& paths,
+                          TableFragment& table)
+  {
+    return getPrioritizedPath(workspace, id, paths, table);
+  }
 
 public:
   Solver(Problem* _P);
   virtual ~Solver();
+
+  void setBucketQueue(bool _use_bucket_queue)
+  {
+    use_bucket_queue = _use_bucket_queue;
+  }
+  void setMaxDistanceTableMB(int _max_distance_table_mb)
+  {
+    max_distance_table_mb = _max_distance_table_mb;
+  }
+  void setThreads(int _threads) { threads = _threads; }
+  void setDistanceTableCache(const std::string& _distance_table_cache)
+  {
+    distance_table_cache = _distance_table_cache;
+  }
 };
+
+// single agent path finding: A* (根据死锁约束进行了改造)
+template <class CheckInvalidMoveFunc, class OpenList>
+Path Solver::getPathWithOpenList(SearchWorkspace& W, const int id,
+                                 CheckInvalidMoveFunc&& checkInvalidMove,
+                                 OpenList&& OPEN)
+{
+  // 获取开始位置和目标位置
+  Node* const s = P->getStart(id);
+  Node* const g = P->getGoal(id);
+
+  // CLOSE list is in W, OPEN is prepared by the caller
+  // initial node
+  AstarNode* n = W.createNewNode(s, 0, pathDist(id, s), nullptr);
+  OPEN.push(n);
+
+  // main loop
+  bool invalid = true;
+  while (!OPEN.empty()) {
+    // check time limit
+    if (W.deadline->expired()) break;
+
+    // minimum node
+    n = OPEN.pop();
+
+    // check CLOSE list
+    const int v = GV->getIndex(n->v);
+    if (W.isClosed(v)) continue;
+    W.close(v);
+    ++W.expanded;
+
+    // check goal condition
+    if (n->v == g) {
+      invalid = false;
+      break;
+    }
+
+    // expand, in random order without copying neighbors
+    const auto C = GV->getNeighbors(v);
+    auto& order = W.order;
+    order.resize(C.size());
+    for (int j = 0; j < C.size(); ++j) {
+      const int k = W.rng.getInt(j + 1);
+      order[j] = order[k];
+      order[k] = j;
+    }
+    for (auto j : order) {
+      // already searched?
+      if (W.isClosed(C[j])) continue;
+      // check constraints
+      Node* const u = GV->getNode(C[j]);
+      if (checkInvalidMove(u, n->v)) continue;  // 违反了约束，如包含路径(u->v)
+      int g_cost = n->g + 1;
+      OPEN.push(W.createNewNode(u, g_cost, g_cost + pathDist(id, C[j]), n));
+    }
+  }
+
+  Path path;
+  if (!invalid) {           // success
+    while (n != nullptr) {  // 构建path，该path满足约束
+      path.push_back(n->v);
+      n = n->p;
+    }
+    std::reverse(path.begin(), path.end());
+  }
+
+  return path;
+}
+
+template <class CheckInvalidMoveFunc, class CompareFunc>
+Path Solver::getPath(SearchWorkspace& W, const int id,
+                     CheckInvalidMoveFunc&& checkInvalidMove,
+                     CompareFunc&& compare)
+{
+  W.reset(G->getNodesSize());
+  // same order as std::priority_queue
+  auto comp = [&compare](AstarNode* a, AstarNode* b) { return compare(a, b); };
+  return getPathWithOpenList(W, id, checkInvalidMove,
+                             BinaryHeap<decltype(comp)>{W.OPEN, comp});
+}
+
+template <class CheckInvalidMoveFunc, class CompareFunc, class KeyFunc>
+Path Solver::getPath(SearchWorkspace& W, const int id,
+                     CheckInvalidMoveFunc&& checkInvalidMove,
+                     CompareFunc&& compare, KeyFunc&& key)
+{
+  if (!use_bucket_queue) return getPath(W, id, checkInvalidMove, compare);
+  W.reset(G->getNodesSize());
+  auto comp = [&compare](AstarNode* a, AstarNode* b) { return compare(a, b); };
+  auto k = [&key](AstarNode* a) { return key(a); };
+  return getPathWithOpenList(
+      W, id, checkInvalidMove,
+      BucketQueue<decltype(k), decltype(comp)>{W, k, comp});
+}
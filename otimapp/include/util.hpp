@@ -5,6 +5,7 @@
 #pragma once
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <deque>
 #include <iostream>
 #include <random>
@@ -57,6 +58,28 @@ static T randomChoose(const std::vector<T>& arr, std::mt19937* const MT)
   return arr[getRandomInt(0, arr.size() - 1, MT)];
 }
 
+// small and fast generator for hot loops, e.g., tie-breaking in A*
+// also usable with std::shuffle
+struct SplitMix64 {
+  using result_type = uint64_t;
+  uint64_t state;
+
+  SplitMix64(const uint64_t seed = 0) : state(seed) {}
+
+  static constexpr uint64_t min() { return 0; }
+  static constexpr uint64_t max() { return UINT64_MAX; }
+  uint64_t operator()()
+  {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // return [0, n), by multiply-shift instead of modulo
+  int getInt(const int n) { return ((*this)() >> 32) * (uint64_t)n >> 32; }
+};
+
 // get elapsed time
 [[maybe_unused]] static double getElapsedTime(const Time::time_point& t_start)
 {
@@ -1,8 +1,17 @@
 #include "../include/dbs.hpp"
 
+#include <fstream>
+#include <unordered_set>
+
 const std::string DBS::SOLVER_NAME = "DBS";
 
-DBS::DBS(Problem* _P) : Solver(_P), max_fragment_size(DEFAULT_MAX_FRAGMENT_SIZE)
+DBS::DBS(Problem* _P)
+    : Solver(_P),
+      max_fragment_size(DEFAULT_MAX_FRAGMENT_SIZE),
+      partial_agent(-1),
+      h_node_expanded(0),
+      h_node_generated(0),
+      head_on_cnt(0)
 {
   solver_name = SOLVER_NAME;
 }
@@ -18,6 +27,12 @@ void DBS::run()
     return false;
   };
 
+  // setup table of potential deadlocks
+  table = std::make_unique<TableFragment>(G, max_fragment_size);
+  table_paths.assign(P->getNum(), nullptr);
+  checkpoints.assign(P->getNum(), 0);
+  setupEdgeUsage();
+
   // OPEN
   std::priority_queue<HighLevelNode_p, HighLevelNodes, decltype(compare)> Tree(
       compare);
@@ -31,21 +46,27 @@ void DBS::run()
   Tree.push(n);
 
   // start high-level search
-  int h_node_num = 1;
-  int iteration = 0;
+  h_node_generated = 1;
+  Paths paths;
   while (!Tree.empty()) {
-    ++iteration;
+    ++h_node_expanded;
 
     // popup one node
     n = Tree.top();
     Tree.pop();
+    head_on_cnt = n->f;
 
     info(" ", "elapsed:", getSolverElapsedTime(),
-         ", explored_node_num:", iteration, ", nodes_num:", h_node_num,
-         ", constraints:", n->constraints.size(), ", head-collision:", n->f);
+         ", explored_node_num:", h_node_expanded,
+         ", nodes_num:", h_node_generated,
+         ", constraints:", n->depth, ", head-collision:", n->f);
 
     // check conflict
-    auto constraints = getConstraints(n->paths);
+    getPaths(n, paths);
+    updateEdgeUsage(paths);
+    auto constraints = getConstraints(paths);
+    // release the previous node only after its paths are compared
+    last_node = n;
 
     // check limitation
     if (overCompTime()) {
@@ -60,16 +81,16 @@ void DBS::run()
 
     // create new nodes
     for (auto c : constraints) {
-      auto m = invoke(n, c);  // 根据DBS中的父节点创建子节点
+      auto m = invoke(n, c, paths);  // 根据DBS中的父节点创建子节点
       if (m->valid) {
         Tree.push(m);
-        ++h_node_num;
+        ++h_node_generated;
       }
     }
   }
 
   if (solved) {
-    solution = n->paths;
+    for (auto p : paths) solution.push_back(*p);
   } else if (Tree.empty()) {
     info(" ", "unsolvable instance");
     unsolvable = true;
@@ -79,15 +100,14 @@ void DBS::run()
 DBS::HighLevelNode_p DBS::getInitialNode()
 {
   auto n = std::make_shared<HighLevelNode>();
-
-  // to manage potential deadlocks
-  auto table = new TableFragment(G, max_fragment_size);
+  initial_paths.clear();
+  initial_paths.reserve(P->getNum());
 
   for (int i = 0; i < P->getNum(); ++i) {
     // find a deadlock-free path as much as possible
     auto t_p = Time::now();
     // 当前solution=∅, 为agent i规划路径
-    auto p = getPrioritizedPath(i, n->paths, *table);
+    auto p = getPrioritizedPath(i, initial_paths, *table);
     elapsed_time_pathfinding += getElapsedTime(t_p);
 
     // failed to find such a path
@@ -99,46 +119,78 @@ DBS::HighLevelNode_p DBS::getInitialNode()
       // fail to find a path
       if (p.empty()) {
         n->valid = false;
-        break;
+        return n;
       }
     }
-    n->paths.push_back(p);
+    initial_paths.push_back(p);
+    n->f += updateEdgeUsage(i, &initial_paths.back());
 
     // update tables
     auto t_d = Time::now();
-    table->registerNewPath(i, p, true, getRemainedTime());
+    checkpoints[i] = table->getCheckpoint();
+    table->registerNewPath(i, p, true, &deadline);
+    table_paths[i] = &initial_paths.back();
     elapsed_time_deadlock_detection += getElapsedTime(t_d);
   }
 
+  // keep agents until the first potential deadlock appears
   auto t_d = Time::now();
-  delete table;
+  int k = P->getNum();
+  for (auto c : table->cycles) {
+    k = std::min(k, *std::max_element(c->agents, c->agents + c->size));
+  }
+  rollbackTable(k);
   elapsed_time_deadlock_detection += getElapsedTime(t_d);
 
-  // counts head-on collisions
-  n->f = countsSwapConlicts(n->paths);
   return n;
 }
 
+void DBS::getPaths(HighLevelNode_p n, Paths& paths)
+{
+  paths.assign(P->getNum(), nullptr);
+
+  // the latest update of each agent
+  int remained = P->getNum();
+  for (auto m = n.get(); m->parent != nullptr && remained > 0;
+       m = m->parent.get()) {
+    auto i = m->constraint->agent;
+    if (paths[i] != nullptr) continue;
+    paths[i] = &m->path;
+    --remained;
+  }
+
+  // otherwise, the paths of the root
+  for (int i = 0; i < P->getNum(); ++i) {
+    if (paths[i] == nullptr) paths[i] = &initial_paths[i];
+  }
+}
+
 // 根据父节点和约束，扩展子节点
-DBS::HighLevelNode_p DBS::invoke(HighLevelNode_p n, Constraint_p c)
+DBS::HighLevelNode_p DBS::invoke(HighLevelNode_p n, Constraint_p c,
+                                 Paths& paths)
 {
   auto m = std::make_shared<HighLevelNode>();
 
   // setup constraints
-  m->constraints = n->constraints;
-  m->constraints.push_back(c);
+  m->parent = n;
+  m->constraint = c;
+  m->depth = n->depth + 1;
 
   // create new solution
-  m->paths = n->paths;
   auto t_d = Time::now();
-  m->paths[c->agent] = getConstrainedPath(c->agent, m);
+  m->path = getConstrainedPath(c->agent, m);
   elapsed_time_deadlock_detection += getElapsedTime(t_d);
 
   // failed to find a path
-  m->valid = !m->paths[c->agent].empty();
-
-  // count head-on collisions
-  m->f = countsSwapConlicts(m->paths);
+  m->valid = !m->path.empty();
+
+  // count head-on collisions, only the edges of the agent are checked
+  if (m->valid) {
+    auto& path_parent = *paths[c->agent];
+    m->f = n->f + addEdgeUsage(path_parent, -1) + addEdgeUsage(m->path, 1);
+    addEdgeUsage(m->path, -1);
+    addEdgeUsage(path_parent, 1);
+  }
 
   return m;
 }
@@ -148,43 +200,34 @@ Path DBS::getConstrainedPath(const int id, HighLevelNode_p node)
 {
   Node* const g = P->getGoal(id);
 
-  // extract relevant constraints
-  Constraints constraints;
-  for (auto c : node->constraints) {
-    if (c->agent == id) constraints.push_back(c);
+  // extract relevant constraints as a set of forbidden edges
+  const uint64_t nodes_size = G->getNodesSize();
+  std::unordered_set<uint64_t> forbidden_edges;
+  for (auto m = node.get(); m->parent != nullptr; m = m->parent.get()) {
+    auto c = m->constraint;
+    if (c->agent != id) continue;
+    forbidden_edges.insert(c->parent->id * nodes_size + c->child->id);
   }
 
   auto checkInvalidMove = [&](Node* child, Node* parent) {
     // condition 1, avoid goals
     if (child != g && table_goals[child->id]) return true;
     // condition 2, follow constraints
-    for (auto c : constraints) {
-      if (c->child == child && c->parent == parent) return true;
-    }
-    return false;
+    return !forbidden_edges.empty() &&
+           forbidden_edges.count(parent->id * nodes_size + child->id) > 0;
   };
 
-  // for tie-breaking
-  std::vector<std::vector<int>> from_to_table(G->getNodesSize());
-  for (int i = 0; i < (int)node->paths.size(); ++i) {
-    if (i == id) continue;
-    auto p = node->paths[i];
-    for (int t = 1; t < (int)p.size(); ++t) {
-      from_to_table[p[t - 1]->id].push_back(p[t]->id);
-    }
-  }
+  // for tie-breaking, exclude the agent itself
+  auto path_current = usage_paths[id];
+  if (path_current != nullptr) addEdgeUsage(*path_current, -1);
 
   auto compare = [&](AstarNode* a, AstarNode* b) {
     // greedy search
     if (pathDist(id, a->v) != pathDist(id, b->v))
       return pathDist(id, a->v) > pathDist(id, b->v);
     // tie break, avoid swap conflicts
-    auto table_a = from_to_table[a->p->v->id];
-    auto table_b = from_to_table[b->p->v->id];
-    bool swap_a =
-        std::find(table_a.begin(), table_a.end(), a->v->id) != table_a.end();
-    bool swap_b =
-        std::find(table_b.begin(), table_b.end(), b->v->id) != table_b.end();
+    bool swap_a = edge_usage[getEdgeIndex(a->p->v, a->v)] > 0;
+    bool swap_b = edge_usage[getEdgeIndex(b->p->v, b->v)] > 0;
     if (swap_a != swap_b) return (int)swap_a < (int)swap_b;
     // tie break, distance so far
     if (a->g != b->g) return a->g < b->g;
@@ -192,58 +235,116 @@ Path DBS::getConstrainedPath(const int id, HighLevelNode_p node)
   };
 
   // use A-star search
-  return Solver::getPath(id, checkInvalidMove, compare);
+  auto key = [&](AstarNode* a) { return pathDist(id, a->v); };
+  auto path = Solver::getPath(id, checkInvalidMove, compare, key);
+  if (path_current != nullptr) addEdgeUsage(*path_current, 1);
+  return path;
 }
 
-DBS::Constraints DBS::getConstraints(const Plan& paths)
+DBS::Constraints DBS::getConstraints(const Paths& paths)
 {
   Constraints constraints = {};
-  auto table = new TableFragment(G, max_fragment_size);
+  auto t_d = Time::now();
+
+  // reuse the registration until the first changed path
+  int k = 0;
+  while (k < P->getNum() && k != partial_agent && table_paths[k] == paths[k]) {
+    ++k;
+  }
+  rollbackTable(k);
 
   // main loop
-  for (int i = 0; i < P->getNum(); ++i) {
-    auto t_d = Time::now();
-    auto c = table->registerNewPath(i, paths[i], false, getRemainedTime());
-    elapsed_time_deadlock_detection += getElapsedTime(t_d);
+  for (int i = k; i < P->getNum(); ++i) {
+    checkpoints[i] = table->getCheckpoint();
+    auto c = table->registerNewPath(i, *paths[i], false, &deadline);
+    table_paths[i] = paths[i];
+    // registration may be interrupted by the time limit
+    if (c != nullptr || overCompTime()) partial_agent = i;
     // found potential deadlocks
     if (c != nullptr) {
       // 根据找到的潜在死锁，创建约束
-      for (int i = 0; i < (int)c->agents.size(); ++i) {
+      for (int j = 0; j < c->size; ++j) {
         constraints.push_back(std::make_shared<Constraint>(
-            c->agents[i], c->path[i], c->path[i + 1]));
+            c->agents[j], G->getNode(c->path[j]), G->getNode(c->path[j + 1])));
       }
-      break;
     }
+    if (partial_agent != -1) break;
   }
-
-  auto t_d = Time::now();
-  delete table;
   elapsed_time_deadlock_detection += getElapsedTime(t_d);
 
   return constraints;
 }
 
-// 计算一个solution中的swap冲突个数
-int DBS::countsSwapConlicts(const Plan& paths)
+void DBS::rollbackTable(const int k)
+{
+  if (k >= P->getNum() || table_paths[k] == nullptr) return;
+
+  // registered agents are always a prefix
+  auto t_d = Time::now();
+  table->rollback(checkpoints[k]);
+  for (int i = k; i < P->getNum(); ++i) table_paths[i] = nullptr;
+  if (partial_agent >= k) partial_agent = -1;
+  elapsed_time_table_release += getElapsedTime(t_d);
+}
+
+void DBS::setupEdgeUsage()
+{
+  edge_usage.assign(GV->getEdgesSize(), 0);
+  usage_paths.assign(P->getNum(), nullptr);
+}
+
+int DBS::getEdgeIndex(Node* const u, Node* const v) const
+{
+  return GV->getEdgeIndex(GV->getIndex(u), GV->getIndex(v));
+}
+
+// 一条边u->v与反向边v->u各出现一次，计为一个swap冲突
+int DBS::addEdgeUsage(const Path& path, const int delta)
 {
-  std::vector<std::vector<int>> to_from_table(G->getNodesSize());
   int cnt = 0;
-  for (auto p : paths) {
-    for (int t = 1; t < (int)p.size(); ++t) {
-      // 依次取出每一对：u->v
-      auto u = p[t - 1];
-      auto v = p[t];
-      // check head-on collisions
-      for (auto i : to_from_table[v->id]) {
-        if (i == u->id) ++cnt;
-      }
-      // register
-      to_from_table[u->id].push_back(v->id);
-    }
+  for (int t = 1; t < (int)path.size(); ++t) {
+    auto u = path[t - 1];
+    auto v = path[t];
+    edge_usage[getEdgeIndex(u, v)] += delta;
+    cnt += delta * edge_usage[getEdgeIndex(v, u)];
   }
   return cnt;
 }
 
+int DBS::updateEdgeUsage(const int id, const Path* path)
+{
+  if (usage_paths[id] == path) return 0;
+  int cnt = 0;
+  if (usage_paths[id] != nullptr) cnt += addEdgeUsage(*usage_paths[id], -1);
+  cnt += addEdgeUsage(*path, 1);
+  usage_paths[id] = path;
+  return cnt;
+}
+
+void DBS::updateEdgeUsage(const Paths& paths)
+{
+  for (int i = 0; i < (int)paths.size(); ++i) updateEdgeUsage(i, paths[i]);
+}
+
+Plan DBS::getLastNodePaths()
+{
+  Plan plan;
+  if (last_node == nullptr) return plan;
+  Paths paths;
+  getPaths(last_node, paths);
+  for (auto p : paths) plan.push_back(*p);
+  return plan;
+}
+
+void DBS::makeLogBasicInfo(std::ofstream& log)
+{
+  Solver::makeLogBasicInfo(log);
+  log << "high_level_expanded=" << h_node_expanded << "\n";
+  log << "high_level_generated=" << h_node_generated << "\n";
+  log << "head_on_collisions=" << head_on_cnt << "\n";
+  makeLogFragmentIndex(log, table.get());
+}
+
 void DBS::setParams(int argc, char* argv[])
 {
   struct option longopts[] = {
@@ -0,0 +1,370 @@
+#include "../include/distance_table.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+DistanceTable::DistanceTable(const GraphView* _G,
+                             const std::vector<Node*>& agent_goals)
+    : G(_G),
+      nodes_size(G->getNodesSize()),
+      compact(isCompactGraph(G)),
+      clock(0),
+      max_bytes(0),
+      used_bytes(0),
+      computed_cnt(0),
+      grid_width(0),
+      words_per_row(0),
+      graph_hash(0),
+      cache_hits(0)
+{
+  // share tables among agents with the same goal
+  std::unordered_map<int, int> goal_table;
+  for (auto g : agent_goals) {
+    auto itr = goal_table.find(g->id);
+    if (itr == goal_table.end()) {
+      itr = goal_table.emplace(g->id, goals.size()).first;
+      goals.push_back(g);
+    }
+    agent_table.push_back(itr->second);
+  }
+  tables.resize(goals.size());
+  tables_wide.resize(goals.size());
+  last_used.resize(goals.size(), 0);
+  setupBitboard();
+}
+
+bool DistanceTable::isCompactGraph(const GraphView* G)
+{
+  int cnt = 0;
+  for (int v = 0; v < G->getNodesSize(); ++v) {
+    if (G->existNode(v)) ++cnt;
+  }
+  return cnt < UNREACHABLE;
+}
+
+void DistanceTable::setupBitboard()
+{
+  if (!G->isGrid()) return;
+  const int width = G->getWidth();
+  const int height = G->getHeight();
+  auto passableCell = [&](const int x, const int y) {
+    return 0 <= x && x < width && 0 <= y && y < height &&
+           G->existNode(G->getIndex(y * width + x));
+  };
+
+  // neighbors are exactly the 4 adjacent cells
+  for (int v = 0; v < nodes_size; ++v) {
+    if (!G->existNode(v)) continue;
+    const int x = G->getX(v);
+    const int y = G->getY(v);
+    for (auto u : G->getNeighbors(v)) {
+      if (std::abs(G->getX(u) - x) + std::abs(G->getY(u) - y) != 1) return;
+    }
+    const int degree = passableCell(x - 1, y) + passableCell(x + 1, y) +
+                       passableCell(x, y - 1) + passableCell(x, y + 1);
+    if (G->getDegree(v) != degree) return;
+  }
+
+  // the padding word keeps shifts from carrying between rows
+  grid_width = width;
+  words_per_row = width / 64 + 1;
+  passable.assign((height + 2) * words_per_row, 0);
+  for (int v = 0; v < nodes_size; ++v) {
+    if (!G->existNode(v)) continue;
+    const int x = G->getX(v);
+    const int i = (G->getY(v) + 1) * words_per_row + x / 64;
+    passable[i] |= uint64_t(1) << (x & 63);
+  }
+}
+
+template <class T>
+void DistanceTable::bfs(Node* const g, std::vector<T>& table,
+                        std::vector<int>& open) const
+{
+  open.clear();
+  open.push_back(G->getIndex(g));
+  table[G->getIndex(g)] = 0;
+  for (int head = 0; head < (int)open.size(); ++head) {
+    const int d_n = table[open[head]];
+    for (auto m : G->getNeighbors(open[head])) {
+      if (d_n + 1 >= (int)table[m]) continue;
+      table[m] = d_n + 1;
+      open.push_back(m);
+    }
+  }
+}
+
+template <class T>
+void DistanceTable::bfsGrid(Node* const g, std::vector<T>& table) const
+{
+  const int W = words_per_row;
+  const int size = passable.size();
+  std::vector<uint64_t> frontier(size, 0);
+  std::vector<uint64_t> next(size, 0);
+  std::vector<uint64_t> visited(size, 0);
+
+  const int x_g = g->id % grid_width;
+  const int i_g = (g->id / grid_width + 1) * W + x_g / 64;
+  frontier[i_g] = visited[i_g] = uint64_t(1) << (x_g & 63);
+  table[G->getIndex(g)] = 0;
+
+  // words [lo, hi] may be non-zero in the frontier
+  int lo = i_g;
+  int hi = i_g;
+  for (int d = 1; lo <= hi; ++d) {
+    // rows adjacent to the frontier, padding rows are never reached
+    const int from = std::max(W, lo - W);
+    const int to = std::min(size - W - 1, hi + W);
+
+    // expand the frontier to four directions at once
+    for (int i = from; i <= to; ++i) {
+      const uint64_t f = frontier[i];
+      next[i] = ((f << 1) | (frontier[i - 1] >> 63) | (f >> 1) |
+                 (frontier[i + 1] << 63) | frontier[i - W] | frontier[i + W]) &
+                passable[i] & ~visited[i];
+    }
+
+    // update the frontier and record distances
+    lo = size;
+    hi = -1;
+    for (int i = from; i <= to; ++i) {
+      uint64_t b = next[i];
+      frontier[i] = b;
+      if (b == 0) continue;
+      visited[i] |= b;
+      lo = std::min(lo, i);
+      hi = i;
+      const int offset = (i / W - 1) * grid_width + (i % W) * 64;
+      while (b != 0) {
+        table[G->getIndex(offset + __builtin_ctzll(b))] = d;
+        b &= b - 1;
+      }
+    }
+  }
+}
+
+template <class T>
+void DistanceTable::search(const int k, std::vector<T>& table,
+                           std::vector<int>& open) const
+{
+  if (passable.empty()) {
+    bfs(goals[k], table, open);
+  } else {
+    bfsGrid(goals[k], table);
+  }
+}
+
+size_t DistanceTable::tableBytes() const
+{
+  return nodes_size * (compact ? sizeof(Dist) : sizeof(int));
+}
+
+void DistanceTable::compute(const int k) const
+{
+  ++clock;
+
+  // drop least recently used tables to keep the memory limit
+  while (max_bytes > 0 && used_bytes + tableBytes() > max_bytes) {
+    int k_lru = -1;
+    for (int j = 0; j < (int)goals.size(); ++j) {
+      if (tables[j].empty() && tables_wide[j].empty()) continue;
+      if (k_lru == -1 || last_used[j] < last_used[k_lru]) k_lru = j;
+    }
+    if (k_lru == -1) break;  // nothing to drop
+    release(k_lru);
+  }
+
+  // breadth first search from the goal, unless the cache has the table
+  if (compact) {
+    tables[k].assign(nodes_size, UNREACHABLE);
+  } else {
+    tables_wide[k].assign(nodes_size, nodes_size);
+  }
+  used_bytes += tableBytes();
+  if (loadCache(k)) {
+    ++cache_hits;
+    return;
+  }
+  if (compact) {
+    search(k, tables[k], OPEN);
+  } else {
+    search(k, tables_wide[k], OPEN);
+  }
+  ++computed_cnt;
+  saveCache(k);
+}
+
+void DistanceTable::release(const int k) const
+{
+  std::vector<Dist>().swap(tables[k]);
+  std::vector<int>().swap(tables_wide[k]);
+  used_bytes -= tableBytes();
+}
+
+void DistanceTable::computeAll(const int threads)
+{
+  // decide tables to compute, in the same order as the sequential version
+  std::vector<int> targets;
+  for (int k = 0; k < (int)goals.size(); ++k) {
+    if (!tables[k].empty() || !tables_wide[k].empty()) continue;
+    if (max_bytes > 0 && used_bytes + tableBytes() > max_bytes) break;
+    targets.push_back(k);
+    used_bytes += tableBytes();
+  }
+  if (targets.empty()) return;
+
+  // allocate in advance, each worker only writes its own tables
+  ++clock;
+  for (auto k : targets) {
+    if (compact) {
+      tables[k].assign(nodes_size, UNREACHABLE);
+    } else {
+      tables_wide[k].assign(nodes_size, nodes_size);
+    }
+    last_used[k] = clock;
+  }
+
+  const int workers = std::max(1, std::min(threads, (int)targets.size()));
+  std::vector<int> hits(workers, 0);  // counted by each worker
+  auto work = [&](const int offset) {
+    std::vector<int> open;
+    for (int j = offset; j < (int)targets.size(); j += workers) {
+      const int k = targets[j];
+      if (loadCache(k)) {
+        ++hits[offset];
+        continue;
+      }
+      if (compact) {
+        search(k, tables[k], open);
+      } else {
+        search(k, tables_wide[k], open);
+      }
+      saveCache(k);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < workers; ++t) pool.emplace_back(work, t);
+  work(0);
+  for (auto& th : pool) th.join();
+
+  int hits_total = 0;
+  for (auto h : hits) hits_total += h;
+  cache_hits += hits_total;
+  computed_cnt += targets.size() - hits_total;
+}
+
+bool DistanceTable::isReadOnly() const
+{
+  for (int k = 0; k < (int)goals.size(); ++k) {
+    if (tables[k].empty() && tables_wide[k].empty()) return false;
+  }
+  return max_bytes == 0;
+}
+
+// -------------------------------
+// on-disk cache
+// -------------------------------
+void DistanceTable::setCacheDir(const std::string& _cache_dir)
+{
+  cache_dir = _cache_dir;
+  if (cache_dir.empty()) return;
+  std::error_code ec;
+  std::filesystem::create_directories(cache_dir, ec);
+  graph_hash = getGraphHash();
+}
+
+uint64_t DistanceTable::getGraphHash() const
+{
+  // FNV-1a over the adjacency, identical graphs -> identical tables
+  uint64_t h = 0xcbf29ce484222325ULL;
+  auto mix = [&](const uint64_t x) {
+    h ^= x;
+    h *= 0x100000001b3ULL;
+  };
+  mix(nodes_size);
+  for (int v = 0; v < nodes_size; ++v) {
+    if (!G->existNode(v)) {
+      mix(-1);
+      continue;
+    }
+    mix(G->getDegree(v));
+    for (auto u : G->getNeighbors(v)) mix(u);
+  }
+  return h;
+}
+
+std::string DistanceTable::getCacheFile(const int k) const
+{
+  std::stringstream ss;
+  ss << cache_dir << "/" << std::hex << graph_hash << std::dec << "_"
+     << goals[k]->id << (compact ? ".d16" : ".d32");
+  return ss.str();
+}
+
+void* DistanceTable::tableData(const int k) const
+{
+  return compact ? (void*)tables[k].data() : (void*)tables_wide[k].data();
+}
+
+bool DistanceTable::loadCache(const int k) const
+{
+  if (cache_dir.empty()) return false;
+  const int fd = open(getCacheFile(k).c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  // header followed by the raw table
+  bool loaded = false;
+  struct stat st;
+  const size_t file_size = sizeof(CacheHeader) + tableBytes();
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size == file_size) {
+    void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      CacheHeader header;
+      std::memcpy(&header, addr, sizeof(CacheHeader));
+      if (header.magic == CACHE_MAGIC &&
+          header.elem_size == tableBytes() / nodes_size &&
+          header.graph_hash == graph_hash &&
+          header.nodes_size == (uint64_t)nodes_size &&
+          header.goal == (uint64_t)goals[k]->id) {
+        std::memcpy(tableData(k), (char*)addr + sizeof(CacheHeader),
+                    tableBytes());
+        loaded = true;
+      }
+      munmap(addr, file_size);
+    }
+  }
+  close(fd);
+  return loaded;
+}
+
+void DistanceTable::saveCache(const int k) const
+{
+  if (cache_dir.empty()) return;
+
+  // write to a temporal file then rename, for concurrent runs
+  const std::string file = getCacheFile(k);
+  const std::string tmp = file + ".tmp" + std::to_string(getpid());
+  CacheHeader header{CACHE_MAGIC, (uint32_t)(tableBytes() / nodes_size),
+                     graph_hash, (uint64_t)nodes_size,
+                     (uint64_t)goals[k]->id};
+  std::ofstream out(tmp, std::ios::binary);
+  if (!out) return;
+  out.write((char*)&header, sizeof(CacheHeader));
+  out.write((char*)tableData(k), tableBytes());
+  out.close();
+  if (!out || std::rename(tmp.c_str(), file.c_str()) != 0) {
+    std::remove(tmp.c_str());
+  }
+}
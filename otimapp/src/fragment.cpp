@@ -1,56 +1,250 @@
 #include "../include/fragment.hpp"
 
 #include <iostream>
-#include <set>
 
 #include "../include/util.hpp"
 
+bool Fragment::hasAgent(const int i) const
+{
+  if (!(agent_mask & agentBit(i))) return false;
+  return std::find(agents, agents + size, i) != agents + size;
+}
+
+bool Fragment::shareAgents(const Fragment* c) const
+{
+  if (!(agent_mask & c->agent_mask)) return false;
+  for (int k = 0; k < size; ++k) {
+    if (c->hasAgent(agents[k])) return true;
+  }
+  return false;
+}
+
+bool Fragment::shareNodes(const Fragment* c) const
+{
+  if (!(node_mask & c->node_mask)) return false;
+  auto c_path_end = c->path + c->size + 1;
+  for (int k = 0; k <= size; ++k) {
+    if (!(c->node_mask & nodeBit(path[k]))) continue;
+    if (std::find(c->path, c_path_end, path[k]) != c_path_end) return true;
+  }
+  return false;
+}
+
+bool Fragment::isSame(const int* _path, const int* _agents,
+                      const int _size) const
+{
+  // different paths
+  if (size != _size || !std::equal(path, path + size + 1, _path)) return false;
+  // different agents, each agent appears at most once in a fragment
+  for (int k = 0; k < size; ++k) {
+    if (!hasAgent(_agents[k])) return false;
+  }
+  return true;
+}
+
+void Fragment::setupSignatures()
+{
+  agent_mask = 0;
+  node_mask = 0;
+  for (int k = 0; k < size; ++k) agent_mask |= agentBit(agents[k]);
+  for (int k = 0; k <= size; ++k) node_mask |= nodeBit(path[k]);
+}
+
+// splitmix64 finalizer
+static uint64_t mixHash(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+uint64_t Fragment::getHash(const int* path, const int* agents, const int size)
+{
+  // path, order-dependent
+  uint64_t h_path = 0;
+  for (int k = 0; k <= size; ++k) h_path = mixHash(h_path ^ uint64_t(path[k]));
+  // agents, order-independent
+  uint64_t h_agents = 0;
+  for (int k = 0; k < size; ++k) h_agents += mixHash(~uint64_t(agents[k]));
+  return h_path ^ mixHash(h_agents);
+}
+
+Fragment FragmentIndex::TOMBSTONE;
+
+FragmentIndex::FragmentIndex()
+    : slots(1024, nullptr),
+      cnt(0),
+      probes(0),
+      hits(0),
+      collisions(0),
+      used_slots(0)
+{
+}
+
+Fragment* FragmentIndex::find(const std::vector<int>& path,
+                              const std::vector<int>& agents,
+                              const uint64_t hash)
+{
+  ++probes;
+  const size_t mask = slots.size() - 1;
+  for (size_t k = hash & mask; slots[k] != nullptr; k = (k + 1) & mask) {
+    auto c = slots[k];
+    if (c == &TOMBSTONE || c->hash != hash) continue;
+    if (c->isSame(path.data(), agents.data(), agents.size())) {
+      ++hits;
+      return c;
+    }
+    ++collisions;
+  }
+  return nullptr;
+}
+
+void FragmentIndex::insert(Fragment* c)
+{
+  if (2 * (used_slots + 1) > (int)slots.size()) rehash();
+  const size_t mask = slots.size() - 1;
+  size_t k = c->hash & mask;
+  while (slots[k] != nullptr && slots[k] != &TOMBSTONE) k = (k + 1) & mask;
+  if (slots[k] == nullptr) ++used_slots;
+  slots[k] = c;
+  ++cnt;
+}
+
+void FragmentIndex::erase(Fragment* c)
+{
+  const size_t mask = slots.size() - 1;
+  for (size_t k = c->hash & mask; slots[k] != nullptr; k = (k + 1) & mask) {
+    if (slots[k] != c) continue;
+    slots[k] = &TOMBSTONE;
+    --cnt;
+    return;
+  }
+}
+
+void FragmentIndex::rehash()
+{
+  // grow only when tombstones are not dominant
+  auto new_size = slots.size();
+  if (4 * (cnt + 1) > (int)new_size) new_size *= 2;
+  std::vector<Fragment*> old_slots(new_size, nullptr);
+  std::swap(slots, old_slots);
+  cnt = 0;
+  used_slots = 0;
+  for (auto c : old_slots) {
+    if (c != nullptr && c != &TOMBSTONE) insert(c);
+  }
+}
+
+void FragmentIndex::clear()
+{
+  if (used_slots == 0) return;
+  std::fill(slots.begin(), slots.end(), nullptr);
+  cnt = 0;
+  used_slots = 0;
+}
+
+Fragment* FragmentArena::allocate(const int size)
+{
+  Fragment* c;
+  if (!released.empty()) {
+    c = released.back();
+    released.pop_back();
+  } else {
+    if (used == (int)slabs.size() * SLAB_SIZE) {
+      slabs.emplace_back(new Fragment[SLAB_SIZE]);
+    }
+    c = &slabs[used / SLAB_SIZE][used % SLAB_SIZE];
+    c->capacity = 0;
+    ++used;
+  }
+
+  // setup storage
+  if (size > c->capacity) {
+    if (size <= Fragment::INLINE_SIZE) {
+      c->path = c->inline_buf;
+      c->capacity = Fragment::INLINE_SIZE;
+    } else {
+      c->path = allocatePayload(2 * size + 1);
+      c->capacity = size;
+    }
+  }
+  c->size = size;
+  c->agents = c->path + size + 1;
+  c->removed = false;
+  return c;
+}
+
+int* FragmentArena::allocatePayload(const int n)
+{
+  // find a chunk with enough space
+  while (chunk_index < (int)chunks.size() &&
+         chunk_used + n > chunk_sizes[chunk_index]) {
+    ++chunk_index;
+    chunk_used = 0;
+  }
+  if (chunk_index == (int)chunks.size()) {
+    const int chunk_size = std::max(CHUNK_SIZE, n);
+    chunks.emplace_back(new int[chunk_size]);
+    chunk_sizes.push_back(chunk_size);
+    chunk_used = 0;
+  }
+  auto p = chunks[chunk_index].get() + chunk_used;
+  chunk_used += n;
+  return p;
+}
+
+void FragmentArena::reset()
+{
+  used = 0;
+  released.clear();
+  chunk_index = 0;
+  chunk_used = 0;
+}
+
 TableFragment::TableFragment(Graph* _G, const int _max_fragment_size)
     : t_from(_G->getNodesSize()),
       t_to(_G->getNodesSize()),
       G(_G),
-      max_fragment_size(_max_fragment_size)
+      max_fragment_size(_max_fragment_size),
+      is_used_node(_G->getNodesSize(), false),
+      node_fingerprint(_G->getNodesSize(), 0)
 {
 }
 
-TableFragment::~TableFragment()
+// fragments are released together with the arena
+TableFragment::~TableFragment() {}
+
+void TableFragment::clear()
 {
-  for (auto cycles : t_from) {
-    for (auto c : cycles) delete c;
+  for (auto k : used_nodes) {
+    t_from[k].clear();
+    t_to[k].clear();
+    is_used_node[k] = false;
+    node_fingerprint[k] = 0;
   }
+  used_nodes.clear();
+  for (auto& fragments : t_agent) fragments.clear();
+  cycles.clear();
+  history.clear();
+  arena.reset();
+  index.clear();
 }
 
-bool TableFragment::existDuplication(const std::deque<Node*>& path,
-                                     const std::deque<int>& agents)
+bool TableFragment::existDuplication(const std::vector<int>& path,
+                                     const std::vector<int>& agents,
+                                     const uint64_t hash)
 {
-  std::set<int> set_agents;
-  for (auto itr = agents.begin(); itr != agents.end(); ++itr)
-    set_agents.insert(*itr);
-  for (auto c : t_from[path.front()->id]) {
-    // different paths
-    if (c->path != path) continue;
-
-    // different agents
-    std::set<int> c_agents;
-    for (auto itr = c->agents.begin(); itr != c->agents.end(); ++itr)
-      c_agents.insert(*itr);
-    if (c_agents != set_agents) continue;
-
-    // duplication exists
-    return true;
-  }
-  return false;
+  return index.find(path, agents, hash) != nullptr;
 }
 
 // 检查给定路径的拓扑条件是否有效 (验证路径是否符合最大片段大小的限制)
 // ?
-bool TableFragment::isValidTopologyCondition(
-    const std::deque<Node*>& path) const
+bool TableFragment::isValidTopologyCondition(const std::vector<int>& path) const
 {
   if (max_fragment_size == -1) return true;
 
-  auto head = path.front();
-  auto tail = path.back();
+  auto head = G->getNode(path.front());
+  auto tail = G->getNode(path.back());
   auto length = (int)path.size() - 1;  // number of agents in the fragment
 
   // fast check
@@ -58,7 +252,9 @@ bool TableFragment::isValidTopologyCondition(
 
   // finding shortest path
   Nodes prohibited;
-  for (int t = 1; t < (int)path.size() - 1; ++t) prohibited.push_back(path[t]);
+  for (int t = 1; t < (int)path.size() - 1; ++t) {
+    prohibited.push_back(G->getNode(path[t]));
+  }
   // 确保在排除中间节点的情况下，这段路径依然是可达的
   auto p = G->getPath(tail, head, prohibited);
   if (p.empty()) return false;
@@ -67,47 +263,68 @@ bool TableFragment::isValidTopologyCondition(
   return true;
 }
 
-Fragment* TableFragment::createNewFragment(const std::deque<Node*>& path,
-                                           const std::deque<int>& agents)
+Fragment* TableFragment::createNewFragment(const std::vector<int>& path,
+                                           const std::vector<int>& agents,
+                                           const uint64_t hash)
 {
-  auto c = new Fragment();
-  c->agents = agents;
-  c->path = path;
+  auto c = arena.allocate(agents.size());
+  std::copy(path.begin(), path.end(), c->path);
+  std::copy(agents.begin(), agents.end(), c->agents);
+  c->setupSignatures();
+  c->hash = hash;
+  index.insert(c);
 
   // register on tables
-  t_from[c->path.front()->id].push_back(c);
-  t_to[c->path.back()->id].push_back(c);
+  const int head = c->head();
+  const int tail = c->tail();
+  t_from[head].push_back(c);
+  t_to[tail].push_back(c);
+  updateFingerprint(c);
+  for (auto k : {head, tail}) {
+    if (is_used_node[k]) continue;
+    is_used_node[k] = true;
+    used_nodes.push_back(k);
+  }
+  for (auto i : agents) {
+    if (i >= (int)t_agent.size()) t_agent.resize(i + 1);
+    t_agent[i].push_back(c);
+  }
+  if (head == tail) cycles.push_back(c);
+  history.push_back(c);
 
   return c;
 }
 
 Fragment* TableFragment::getPotentialDeadlockIfExist(
-    const std::deque<Node*>& path, const std::deque<int>& agents)
+    const std::vector<int>& path, const std::vector<int>& agents)
 {
   // check topology constraints
   if (path.front() != path.back() && !isValidTopologyCondition(path))
     return nullptr;
 
   // check duplication
-  if (existDuplication(path, agents)) return nullptr;
+  const auto hash =
+      Fragment::getHash(path.data(), agents.data(), agents.size());
+  if (existDuplication(path, agents, hash)) return nullptr;
 
   // create new fragment
-  auto c = createNewFragment(path, agents);
+  auto c = createNewFragment(path, agents, hash);
 
-  return (c->path.front() == c->path.back()) ? c : nullptr;
+  return (c->head() == c->tail()) ? c : nullptr;
 }
 
 // create new entry
-Fragment* TableFragment::getPotentialDeadlockIfExist(const int id, Node* head,
+Fragment* TableFragment::getPotentialDeadlockIfExist(const int id,
+                                                     const int head,
                                                      Fragment* c_base,
-                                                     Node* tail)
+                                                     const int tail)
 {
   // avoid loop with own path
-  if (c_base != nullptr && inArray(id, c_base->agents)) return nullptr;
+  if (c_base != nullptr && c_base->hasAgent(id)) return nullptr;
 
   // check maximum fragment length
   if (c_base != nullptr && max_fragment_size != -1) {
-    auto size = (int)c_base->agents.size() + 1;
+    auto size = c_base->size + 1;
     if (size > max_fragment_size) {
       return nullptr;
     } else if (size == max_fragment_size && head != tail) {
@@ -115,119 +332,118 @@ Fragment* TableFragment::getPotentialDeadlockIfExist(const int id, Node* head,
     }
   }
 
-  // setup agents
-  std::deque<int> agents;
+  // setup agents & path
+  cand_agents.clear();
+  cand_path.clear();
   if (c_base == nullptr) {
-    agents.push_front(id);
+    cand_agents.push_back(id);
+    cand_path.push_back(head);
+    cand_path.push_back(tail);
   } else {
-    agents = c_base->agents;
-    if (c_base->path.front() != head) agents.push_front(id);
-    if (c_base->path.back() != tail) agents.push_back(id);
+    const bool extend_head = c_base->head() != head;
+    const bool extend_tail = c_base->tail() != tail;
+    if (extend_head) {
+      cand_agents.push_back(id);
+      cand_path.push_back(head);
+    }
+    cand_agents.insert(cand_agents.end(), c_base->agents,
+                       c_base->agents + c_base->size);
+    cand_path.insert(cand_path.end(), c_base->path,
+                     c_base->path + c_base->size + 1);
+    if (extend_tail) {
+      cand_agents.push_back(id);
+      cand_path.push_back(tail);
+    }
   }
 
-  // setup path
-  std::deque<Node*> path;
-  if (c_base == nullptr || head != c_base->path.front()) path.push_back(head);
-  if (c_base != nullptr)
-    for (auto itr = c_base->path.begin(); itr != c_base->path.end(); ++itr)
-      path.push_back(*itr);
-  if (c_base == nullptr || tail != c_base->path.back()) path.push_back(tail);
-
-  return getPotentialDeadlockIfExist(path, agents);
+  return getPotentialDeadlockIfExist(cand_path, cand_agents);
 }
 
 // 为一个代理注册新路径并检查潜在的死锁
 // return deadlock or nullptr
 Fragment* TableFragment::registerNewPath(const int id, const Path path,
-                                         const bool force, const int time_limit)
+                                         const bool force,
+                                         const Deadline* deadline)
 {
   Fragment* res = nullptr;
-  auto t_s = Time::now();
+  int created = history.size();
 
   // update cycles step by step
   for (int t = 1; t < (int)path.size(); ++t) {
-    // check time limit
-    if (time_limit >= 0 && getElapsedTime(t_s) > time_limit) return nullptr;
+    // check time limit, weighted by fragments created in the last step
+    const int work = 1 + (int)history.size() - created;
+    created = history.size();
+    if (deadline != nullptr && deadline->expired(work)) return nullptr;
 
-    auto v_before = path[t - 1];
-    auto v_next = path[t];
+    const int v_before = path[t - 1]->id;
+    const int v_next = path[t]->id;
 
     // add own segment
     res = getPotentialDeadlockIfExist(id, v_before, nullptr, v_next);
     if (!force && res != nullptr) return res;
 
     // check existing fragments on table_to
-    for (auto c : t_to[v_before->id]) {
-      res = getPotentialDeadlockIfExist(id, c->path.front(), c, v_next);
+    for (auto c : t_to[v_before]) {
+      res = getPotentialDeadlockIfExist(id, c->head(), c, v_next);
       if (!force && res != nullptr) return res;
     }
 
     // check existing fragments on table_from
-    for (auto c : t_from[v_next->id]) {
-      res = getPotentialDeadlockIfExist(id, v_before, c, c->path.back());
+    for (auto c : t_from[v_next]) {
+      res = getPotentialDeadlockIfExist(id, v_before, c, c->tail());
       if (!force && res != nullptr) return res;
     }
 
     // connect two fragments
     std::vector<Fragment*> c_tails, c_heads;
     // 1. extract candidates
-    for (auto c_tail : t_to[v_before->id])
-      if (!inArray(id, c_tail->agents)) c_tails.push_back(c_tail);
-    for (auto c_head : t_from[v_next->id])
-      if (!inArray(id, c_head->agents)) c_heads.push_back(c_head);
+    for (auto c_tail : t_to[v_before])
+      if (!c_tail->hasAgent(id)) c_tails.push_back(c_tail);
+    for (auto c_head : t_from[v_next])
+      if (!c_head->hasAgent(id)) c_heads.push_back(c_head);
 
     // 2. main loop
     for (auto c_tail : c_tails) {
-      // check time limit
-      if (time_limit >= 0 && getElapsedTime(t_s) > time_limit) return nullptr;
+      // check time limit, weighted by the inner loop
+      if (deadline != nullptr && deadline->expired(c_heads.size() + 1)) {
+        return nullptr;
+      }
 
       for (auto c_head : c_heads) {
         // check length
         if (max_fragment_size != -1) {
-          int size = (int)(c_tail->agents.size() + c_head->agents.size()) + 1;
+          int size = c_tail->size + c_head->size + 1;
           if (size > max_fragment_size) {
             continue;
           } else if (size == max_fragment_size &&
-                     c_tail->path.front() != c_head->path.back()) {
+                     c_tail->head() != c_head->tail()) {
             continue;
           }
         }
 
         // avoid self loop
-        {
-          // agents
-          bool self_loop = false;
-          for (auto i : c_tail->agents) {
-            if (inArray(i, c_head->agents)) {
-              self_loop = true;
-            }
-          }
-          if (self_loop) continue;
-
-          // path
-          for (auto i : c_tail->path) {
-            if (inArray(i, c_head->path)) {
-              self_loop = true;
-            }
-          }
-          if (self_loop) continue;
-        }
+        if (c_tail->shareAgents(c_head) || c_tail->shareNodes(c_head))
+          continue;
 
         // create body
-        std::deque<int> agents;
-        std::deque<Node*> path;
+        cand_agents.clear();
+        cand_path.clear();
         {
           // agents
-          for (auto i : c_tail->agents) agents.push_back(i);
-          agents.push_back(id);
-          for (auto i : c_head->agents) agents.push_back(i);
+          cand_agents.insert(cand_agents.end(), c_tail->agents,
+                             c_tail->agents + c_tail->size);
+          cand_agents.push_back(id);
+          cand_agents.insert(cand_agents.end(), c_head->agents,
+                             c_head->agents + c_head->size);
           // path
-          for (auto v : c_tail->path) path.push_back(v);
-          for (auto v : c_head->path) path.push_back(v);
+          cand_path.insert(cand_path.end(), c_tail->path,
+                           c_tail->path + c_tail->size + 1);
+          cand_path.insert(cand_path.end(), c_head->path,
+                           c_head->path + c_head->size + 1);
         }
 
         // register
-        auto res = getPotentialDeadlockIfExist(path, agents);
+        auto res = getPotentialDeadlockIfExist(cand_path, cand_agents);
         if (!force && res != nullptr) return res;
       }
     }
@@ -236,13 +452,83 @@ Fragment* TableFragment::registerNewPath(const int id, const Path path,
   return res;
 }
 
+void TableFragment::unregisterPath(const int id)
+{
+  if (id >= (int)t_agent.size() || t_agent[id].empty()) return;
+
+  // mark fragments to be removed
+  std::vector<int> heads, tails, agents;
+  for (auto c : t_agent[id]) {
+    c->removed = true;
+    updateFingerprint(c);
+    heads.push_back(c->head());
+    tails.push_back(c->tail());
+    for (int k = 0; k < c->size; ++k) {
+      if (c->agents[k] != id) agents.push_back(c->agents[k]);
+    }
+    index.erase(c);
+  }
+
+  // remove from each list once, keeping the order of remaining fragments
+  auto removeMarked = [](std::vector<Fragment*>& fragments) {
+    fragments.erase(std::remove_if(fragments.begin(), fragments.end(),
+                                   [](Fragment* c) { return c->removed; }),
+                    fragments.end());
+  };
+  auto removeFrom = [&](std::vector<int>& keys,
+                        std::vector<std::vector<Fragment*>>& table) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (auto k : keys) removeMarked(table[k]);
+  };
+  removeFrom(heads, t_from);
+  removeFrom(tails, t_to);
+  removeFrom(agents, t_agent);
+  removeMarked(cycles);
+  removeMarked(history);
+
+  // release
+  for (auto c : t_agent[id]) arena.release(c);
+  t_agent[id].clear();
+}
+
+void TableFragment::rollback(const int checkpoint)
+{
+  // fragments created later are always at the back of each list
+  while ((int)history.size() > checkpoint) {
+    auto c = history.back();
+    history.pop_back();
+    t_from[c->head()].pop_back();
+    t_to[c->tail()].pop_back();
+    updateFingerprint(c);
+    for (int k = 0; k < c->size; ++k) t_agent[c->agents[k]].pop_back();
+    if (c->head() == c->tail()) cycles.pop_back();
+    index.erase(c);
+    arena.release(c);
+  }
+}
+
+void TableFragment::updateFingerprint(Fragment* c)
+{
+  // xor works for both registration and removal
+  node_fingerprint[c->head()] ^= c->hash;
+  node_fingerprint[c->tail()] ^= mixHash(c->hash);
+}
+
+uint64_t TableFragment::getFingerprint(const std::vector<int>& nodes) const
+{
+  uint64_t h = 0;
+  for (auto v : nodes) h += mixHash(node_fingerprint[v] ^ uint64_t(v));
+  return h;
+}
+
 void TableFragment::println()
 {
   for (auto cycles : t_from) {
     for (auto c : cycles) {
-      for (auto v : c->path) std::cout << v->id << " -> ";
+      for (int k = 0; k <= c->size; ++k) std::cout << c->path[k] << " -> ";
       std::cout << " : ";
-      for (auto i : c->agents) std::cout << i << " -> ";
+      for (int k = 0; k < c->size; ++k) std::cout << c->agents[k] << " -> ";
       std::cout << std::endl;
     }
   }
@@ -0,0 +1,97 @@
+#include "../include/graph_view.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+GraphView::GraphView(Graph* G, const Order _order)
+    : nodes_size(G->getNodesSize()), order(ROW_MAJOR), width(0), height(0)
+{
+  auto grid = dynamic_cast<Grid*>(G);
+  if (grid != nullptr && grid->getWidth() * grid->getHeight() == nodes_size) {
+    width = grid->getWidth();
+    height = grid->getHeight();
+  }
+
+  // renumbering is only for grids
+  if (width > 0 && _order != ROW_MAJOR) {
+    order = _order;
+    int n = 1;
+    while (n < std::max(width, height)) n <<= 1;
+    std::vector<uint64_t> keys(nodes_size);
+    for (int id = 0; id < nodes_size; ++id) {
+      const int x = id % width;
+      const int y = id / width;
+      keys[id] = (order == MORTON) ? getMortonKey(x, y)
+                                   : getHilbertKey(x, y, n);
+    }
+    ids.resize(nodes_size);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::sort(ids.begin(), ids.end(),
+              [&](int a, int b) { return keys[a] < keys[b]; });
+    indexes.resize(nodes_size);
+    for (int v = 0; v < nodes_size; ++v) indexes[ids[v]] = v;
+  }
+
+  offsets.assign(nodes_size + 1, 0);
+  nodes.assign(nodes_size, nullptr);
+  for (int v = 0; v < nodes_size; ++v) {
+    if (G->existNode(getId(v))) {
+      nodes[v] = G->getNode(getId(v));
+      for (auto u : nodes[v]->neighbor) adj.push_back(getIndex(u));
+    }
+    offsets[v + 1] = adj.size();
+  }
+}
+
+int GraphView::getEdgeIndex(const int u, const int v) const
+{
+  for (int k = offsets[u]; k < offsets[u + 1]; ++k) {
+    if (adj[k] == v) return k;
+  }
+  return -1;
+}
+
+uint64_t GraphView::getMortonKey(const int x, const int y)
+{
+  // interleave bits, x -> even, y -> odd
+  uint64_t key = 0;
+  for (int b = 0; b < 31; ++b) {
+    key |= (uint64_t)((x >> b) & 1) << (2 * b);
+    key |= (uint64_t)((y >> b) & 1) << (2 * b + 1);
+  }
+  return key;
+}
+
+uint64_t GraphView::getHilbertKey(int x, int y, const int n)
+{
+  // n: power of two covering the grid
+  uint64_t key = 0;
+  for (int s = n / 2; s > 0; s /= 2) {
+    const int rx = (x & s) > 0;
+    const int ry = (y & s) > 0;
+    key += (uint64_t)s * s * ((3 * rx) ^ ry);
+    // rotate the quadrant
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return key;
+}
+
+GraphView::Order GraphView::getOrderByName(const std::string& name)
+{
+  if (name == "morton") return MORTON;
+  if (name == "hilbert") return HILBERT;
+  return ROW_MAJOR;
+}
+
+std::string GraphView::getOrderName(const Order order)
+{
+  if (order == MORTON) return "morton";
+  if (order == HILBERT) return "hilbert";
+  return "row-major";
+}
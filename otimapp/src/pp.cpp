@@ -1,6 +1,10 @@
 #include "../include/pp.hpp"
 
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 const std::string PP::SOLVER_NAME = "PP";
 
@@ -8,7 +12,16 @@ PP::PP(Problem* _P)
     : Solver(_P),
       itr_cnt(0),
       iter_cnt_max(DEFAULT_ITER_CNT_MAX),
-      max_fragment_size(DEFAULT_MAX_FRAGMENT_SIZE)
+      max_fragment_size(DEFAULT_MAX_FRAGMENT_SIZE),
+      search_cnt(0),
+      ordering(RANDOM),
+      ordering_randomized(false),
+      use_path_cache(false),
+      path_cache_hits(0),
+      restart_strategy(SHUFFLE),
+      restart_from(DEFAULT_RESTART_FROM),
+      restart_iter(-1),
+      restart_workers(1)
 {
   solver_name = SOLVER_NAME;
 }
@@ -17,15 +30,28 @@ PP::~PP() {}
 
 void PP::run()
 {
+  setupOrderKeys();
+  if (threads > 1 || restart_from > 0) {
+    runRestarts();
+    return;
+  }
+  if (restart_strategy == PREFIX) {
+    runPrefixRestarts();
+    return;
+  }
+
   // id_list
   std::vector<int> id_list(P->getNum());
   std::iota(id_list.begin(), id_list.end(), 0);
 
+  // setup table of potential deadlocks
+  table = std::make_unique<TableFragment>(G, max_fragment_size);
+
   while (!solved && !overCompTime() && itr_cnt < iter_cnt_max) {
     ++itr_cnt;
 
     // randomize order
-    std::shuffle(id_list.begin(), id_list.end(), *MT);
+    setOrder(id_list, *MT);
 
     // initialize
     solution.clear();
@@ -35,7 +61,6 @@ void PP::run()
 
     // main
     bool invalid = false;
-    auto table = new TableFragment(G, max_fragment_size);
     for (int j = 0; j < P->getNum(); ++j) {
       const int i = id_list[j];
 
@@ -45,8 +70,10 @@ void PP::run()
 
       // get prioritized path
       auto t_p = Time::now();
-      solution[i] = getPrioritizedPath(i, solution, *table);
+      solution[i] = getCachedPath(workspace, i, solution, *table, path_cache,
+                                  path_cache_hits);
       elapsed_time_pathfinding += getElapsedTime(t_p);
+      ++search_cnt;
 
       // failed
       if (solution[i].empty() || overCompTime()) {
@@ -56,22 +83,383 @@ void PP::run()
 
       // register new path
       auto t_d = Time::now();
-      auto c = table->registerNewPath(i, solution[i], false, getRemainedTime());
+      auto c = table->registerNewPath(i, solution[i], false, &deadline);
       elapsed_time_deadlock_detection += getElapsedTime(t_d);
       if (c != nullptr) halt("detect deadlock");
     }
     solved = !invalid;
+    if (ordering == PRESSURE) updatePressure(*table);
+
+    auto t_d = Time::now();
+    table->clear();
+    const int elapsed_release = getElapsedTime(t_d);
+    elapsed_time_deadlock_detection += elapsed_release;
+    elapsed_time_table_release += elapsed_release;
+  }
+}
+
+void PP::runPrefixRestarts()
+{
+  // id_list, modified by promotions, reshuffled when they stall
+  std::vector<int> id_list(P->getNum());
+  std::iota(id_list.begin(), id_list.end(), 0);
+  setOrder(id_list, *MT);
+
+  table = std::make_unique<TableFragment>(G, max_fragment_size);
+  solution.assign(P->getNum(), Path());
+
+  TableFragment table_empty(G, max_fragment_size);  // never registered
+  // table checkpoint before registering the path of each position
+  std::vector<int> checkpoints(P->getNum(), 0);
+  int j = 0;  // first position to be planned
+
+  // promotions may swap a few agents forever, give up after repairs of
+  // one halving sequence without failing at a farther position
+  const int max_stalls = std::ceil(std::log2(P->getNum() + 1)) + 1;
+  int j_max = 0;   // farthest failure since the last shuffle
+  int stalls = 0;  // repairs without exceeding j_max
+
+  while (!overCompTime() && itr_cnt < iter_cnt_max) {
+    ++itr_cnt;
+    info(" ", "iter-" + std::to_string(itr_cnt), "start from", j);
+
+    // plan agents from the divergence point
+    for (; j < P->getNum(); ++j) {
+      const int i = id_list[j];
+      checkpoints[j] = table->getCheckpoint();
+
+      info(" ", "elapsed:", getSolverElapsedTime(), ", iter:", itr_cnt,
+           ", agent-" + std::to_string(i), "starts planning,",
+           "init-dist:", pathDist(i), ", progress:", j + 1, "/", P->getNum());
+
+      // get prioritized path
+      auto t_p = Time::now();
+      solution[i] = getCachedPath(workspace, i, solution, *table, path_cache,
+                                  path_cache_hits);
+      elapsed_time_pathfinding += getElapsedTime(t_p);
+      ++search_cnt;
+
+      // failed
+      if (solution[i].empty() || overCompTime()) break;
+
+      // register new path
+      auto t_d = Time::now();
+      auto c = table->registerNewPath(i, solution[i], false, &deadline);
+      elapsed_time_deadlock_detection += getElapsedTime(t_d);
+      if (c != nullptr) halt("detect deadlock");
+    }
+    if (j == P->getNum()) {
+      solved = true;
+      break;
+    }
+    if (overCompTime()) break;
+
+    // the agent also fails with top priority -> no order helps,
+    // since only goals of others block it without fragments
+    const int i_failed = id_list[j];
+    bool blocked_by_goals = (j == 0);
+    if (!blocked_by_goals) {
+      auto t_p = Time::now();
+      blocked_by_goals =
+          getPrioritizedPath(i_failed, solution, table_empty).empty();
+      elapsed_time_pathfinding += getElapsedTime(t_p);
+      ++search_cnt;
+    }
+    if (overCompTime()) break;
+    if (blocked_by_goals) {
+      info(" ", "agent-" + std::to_string(i_failed), "fails in any order");
+      unsolvable = true;
+      break;
+    }
+
+    auto t_d = Time::now();
+    if (j > j_max) {
+      j_max = j;
+      stalls = 0;
+    } else {
+      ++stalls;
+    }
+    if (stalls > max_stalls) {
+      // restart with a new order
+      if (ordering == PRESSURE) updatePressure(*table);
+      setOrder(id_list, *MT);
+      table->clear();
+      solution.assign(P->getNum(), Path());
+      j = j_max = stalls = 0;
+    } else {
+      // promote the failed agent to the middle of the prefix,
+      // keep paths before the new position
+      const int k = j / 2;
+      table->rollback(checkpoints[k]);
+      for (int l = k; l <= j; ++l) solution[id_list[l]].clear();
+      std::rotate(id_list.begin() + k, id_list.begin() + j,
+                  id_list.begin() + j + 1);
+      j = k;
+    }
+    const int elapsed_release = getElapsedTime(t_d);
+    elapsed_time_deadlock_detection += elapsed_release;
+    elapsed_time_table_release += elapsed_release;
+  }
+
+  auto t_d = Time::now();
+  table->clear();
+  const int elapsed_release = getElapsedTime(t_d);
+  elapsed_time_deadlock_detection += elapsed_release;
+  elapsed_time_table_release += elapsed_release;
+}
+
+void PP::setupOrderKeys()
+{
+  order_keys.assign(P->getNum(), 0);
+  if (ordering == DIST) {
+    for (int i = 0; i < P->getNum(); ++i) order_keys[i] = pathDist(i);
+  } else if (ordering == CONGESTION) {
+    // goal of j is on a shortest path of i
+    for (int i = 0; i < P->getNum(); ++i) {
+      const int d = pathDist(i);
+      for (int j = 0; j < P->getNum(); ++j) {
+        if (j == i) continue;
+        Node* const g = P->getGoal(j);
+        if (pathDist(j, P->getStart(i)) + pathDist(i, g) == d) {
+          ++order_keys[i];
+        }
+      }
+    }
+  }
+}
+
+void PP::updatePressure(const TableFragment& table)
+{
+  for (int i = 0; i < P->getNum(); ++i) {
+    for (auto v : {P->getStart(i)->id, P->getGoal(i)->id}) {
+      order_keys[i] += table.t_from[v].size() + table.t_to[v].size();
+    }
+  }
+}
+
+template <class URBG>
+void PP::setOrder(std::vector<int>& id_list, URBG& rng)
+{
+  // also breaks ties
+  std::shuffle(id_list.begin(), id_list.end(), rng);
+  if (ordering == RANDOM) return;
+
+  if (!ordering_randomized) {
+    std::stable_sort(id_list.begin(), id_list.end(), [&](int i, int j) {
+      return order_keys[i] > order_keys[j];
+    });
+    return;
+  }
+
+  // weighted random permutation, larger log(u) / weight is earlier
+  std::uniform_real_distribution<double> dist(0, 1);
+  std::vector<double> samples(P->getNum());
+  for (int i = 0; i < P->getNum(); ++i) {
+    samples[i] = std::log(1 - dist(rng)) / (order_keys[i] + 1);
+  }
+  std::stable_sort(id_list.begin(), id_list.end(),
+                   [&](int i, int j) { return samples[i] > samples[j]; });
+}
+
+Path PP::getCachedPath(SearchWorkspace& W, const int id, const Plan& paths,
+                       TableFragment& table, PathCaches& cache, int& hits)
+{
+  if (!use_path_cache) return getPrioritizedPath(W, id, paths, table);
+  if (cache.empty()) cache.resize(P->getNum());
+
+  auto& entry = cache[id];
+  if (!entry.path.empty() &&
+      table.getFingerprint(entry.nodes) == entry.fingerprint) {
+    ++hits;
+    return entry.path;
+  }
 
+  auto path = getPrioritizedPath(W, id, paths, table);
+  if (!path.empty()) {
+    entry.path = path;
+    W.getCreatedNodes(entry.nodes);
+    entry.fingerprint = table.getFingerprint(entry.nodes);
+  }
+  return path;
+}
+
+uint64_t PP::getIterationSeed(const int iter) const
+{
+  return SplitMix64(((uint64_t)P->getSeed() << 32) ^ iter)();
+}
+
+uint64_t PP::getAgentSeed(const int id) const
+{
+  // iteration 0 is never run, its seed is reserved for agents
+  return SplitMix64(getIterationSeed(0) + id)();
+}
+
+std::vector<int> PP::getIterationOrder(const int iter, SplitMix64& rng)
+{
+  rng = SplitMix64(getIterationSeed(iter));
+  std::vector<int> id_list(P->getNum());
+  std::iota(id_list.begin(), id_list.end(), 0);
+  setOrder(id_list, rng);
+  return id_list;
+}
+
+std::vector<int> PP::getIterationOrder(const int iter)
+{
+  SplitMix64 rng;
+  return getIterationOrder(iter, rng);
+}
+
+bool PP::runIteration(const int iter, Worker& w)
+{
+  // priorities and tie-breaking, only from the iteration number
+  SplitMix64 rng;
+  auto id_list = getIterationOrder(iter, rng);
+  w.workspace.rng = SplitMix64(rng());
+
+  w.solution.assign(P->getNum(), Path());
+  bool invalid = false;
+  for (auto i : id_list) {
+    // get prioritized path
+    auto t_p = Time::now();
+    if (use_path_cache) w.workspace.rng = SplitMix64(getAgentSeed(i));
+    w.solution[i] = getCachedPath(w.workspace, i, w.solution, *w.table,
+                                  w.path_cache, w.path_cache_hits);
+    w.elapsed_time_pathfinding += getElapsedTime(t_p);
+    ++w.search_cnt;
+
+    // failed
+    if (w.solution[i].empty() || w.deadline.expiredNow()) {
+      invalid = true;
+      break;
+    }
+
+    // register new path
     auto t_d = Time::now();
-    delete table;
-    elapsed_time_deadlock_detection += getElapsedTime(t_d);
+    auto c = w.table->registerNewPath(i, w.solution[i], false, &w.deadline);
+    w.elapsed_time_deadlock_detection += getElapsedTime(t_d);
+    if (c != nullptr) halt("detect deadlock");
+  }
+
+  auto t_d = Time::now();
+  w.table->clear();
+  const int elapsed_release = getElapsedTime(t_d);
+  w.elapsed_time_deadlock_detection += elapsed_release;
+  w.elapsed_time_table_release += elapsed_release;
+  return !invalid;
+}
+
+void PP::runRestarts()
+{
+  // workers read distance tables concurrently
+  restart_workers = std::max(1, threads);
+  if (restart_workers > 1 && !distance_table.isReadOnly()) {
+    info("  distance tables are not ready for threads, use one worker");
+    restart_workers = 1;
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int k = 0; k < restart_workers; ++k) {
+    auto w = std::make_unique<Worker>();
+    w->workspace.deadline = &w->deadline;
+    w->deadline.set(Time::now(), getRemainedTime());
+    w->deadline.setParent(&deadline);
+    w->table = std::make_unique<TableFragment>(G, max_fragment_size);
+    workers.push_back(std::move(w));
+  }
+
+  const int first = std::max(1, restart_from);
+  std::atomic<int> next_iter(first);
+  std::mutex mtx;
+  Worker* winner = nullptr;
+  auto work = [&](Worker* w) {
+    while (!w->deadline.expiredNow()) {
+      const int iter = next_iter++;
+      if (iter >= first + iter_cnt_max) break;
+      ++w->itr_cnt;
+      if (!runIteration(iter, *w)) continue;
+      std::lock_guard<std::mutex> lock(mtx);
+      if (winner == nullptr) {
+        winner = w;
+        restart_iter = iter;
+        // stop the others
+        for (auto& other : workers) other->deadline.cancel();
+      }
+      break;
+    }
+  };
+  std::vector<std::thread> threads_pool;
+  for (int k = 1; k < restart_workers; ++k) {
+    threads_pool.emplace_back(work, workers[k].get());
+  }
+  work(workers[0].get());
+  for (auto& th : threads_pool) th.join();
+
+  // summarize
+  for (auto& w : workers) {
+    itr_cnt += w->itr_cnt;
+    search_cnt += w->search_cnt;
+    path_cache_hits += w->path_cache_hits;
+    elapsed_time_pathfinding += w->elapsed_time_pathfinding;
+    elapsed_time_deadlock_detection += w->elapsed_time_deadlock_detection;
+    elapsed_time_table_release += w->elapsed_time_table_release;
+    workspace.expanded += w->workspace.expanded;
+  }
+  if (winner != nullptr) {
+    solved = true;
+    solution = winner->solution;
+    info("  solved at iteration", restart_iter);
   }
+  table = std::move((winner != nullptr ? winner : workers[0].get())->table);
 }
 
 void PP::makeLogBasicInfo(std::ofstream& log)
 {
   log << "repetation_PP=" << itr_cnt << "\n";
+  log << "restart_iteration=" << restart_iter << "\n";
+  log << "restart_workers=" << restart_workers << "\n";
+  log << "restart_strategy=" << getRestartStrategyName(restart_strategy)
+      << "\n";
+  log << "search_PP=" << search_cnt << "\n";
+  log << "ordering=" << getOrderingName(ordering)
+      << (ordering_randomized ? "-rand" : "") << "\n";
+  log << "path_cache_hits=" << path_cache_hits << "\n";
   Solver::makeLogBasicInfo(log);
+  makeLogFragmentIndex(log, table.get());
+}
+
+PP::RestartStrategy PP::getRestartStrategyByName(const std::string& name)
+{
+  if (name == "prefix") return PREFIX;
+  return SHUFFLE;
+}
+
+std::string PP::getRestartStrategyName(const RestartStrategy strategy)
+{
+  if (strategy == PREFIX) return "prefix";
+  return "shuffle";
+}
+
+// e.g., dist, dist-rand
+PP::Ordering PP::getOrderingByName(const std::string& name)
+{
+  const std::string base = name.substr(0, name.find("-rand"));
+  if (base == "dist") return DIST;
+  if (base == "congestion") return CONGESTION;
+  if (base == "pressure") return PRESSURE;
+  return RANDOM;
+}
+
+bool PP::isRandomizedOrdering(const std::string& name)
+{
+  return name.find("-rand") != std::string::npos;
+}
+
+std::string PP::getOrderingName(const Ordering ordering)
+{
+  if (ordering == DIST) return "dist";
+  if (ordering == CONGESTION) return "congestion";
+  if (ordering == PRESSURE) return "pressure";
+  return "random";
 }
 
 void PP::setParams(int argc, char* argv[])
@@ -79,12 +467,17 @@ void PP::setParams(int argc, char* argv[])
   struct option longopts[] = {
       {"iter-cnt-max", required_argument, 0, 'm'},
       {"max-fragment-size", required_argument, 0, 'f'},
+      {"restart-from", required_argument, 0, 'a'},
+      {"restart", required_argument, 0, 'R'},
+      {"path-cache", no_argument, 0, 'c'},
+      {"ordering", required_argument, 0, 'g'},
       {0, 0, 0, 0},
   };
 
   optind = 1;  // reset
   int opt, longindex;
-  while ((opt = getopt_long(argc, argv, "m:f:", longopts, &longindex)) != -1) {
+  while ((opt = getopt_long(argc, argv, "m:f:a:R:cg:", longopts, &longindex)) !=
+         -1) {
     switch (opt) {
       case 'm':
         iter_cnt_max = std::atoi(optarg);
@@ -92,6 +485,19 @@ void PP::setParams(int argc, char* argv[])
       case 'f':
         max_fragment_size = std::atoi(optarg);
         break;
+      case 'a':
+        restart_from = std::atoi(optarg);
+        break;
+      case 'R':
+        restart_strategy = getRestartStrategyByName(std::string(optarg));
+        break;
+      case 'c':
+        use_path_cache = true;
+        break;
+      case 'g':
+        ordering = getOrderingByName(std::string(optarg));
+        ordering_randomized = isRandomizedOrdering(std::string(optarg));
+        break;
       default:
         break;
     }
@@ -112,5 +518,30 @@ void PP::printHelp()
             << "        "
             << "maximum fragment size"
 
+            << "\n"
+
+            << "  -a --restart-from"
+            << "             "
+            << "first iteration of restarts with derived seeds"
+
+            << "\n"
+
+            << "  -R --restart [STRATEGY]"
+            << "       "
+            << "shuffle/prefix, restart after failures in one thread"
+
+            << "\n"
+
+            << "  -c --path-cache"
+            << "               "
+            << "reuse paths over restarts while fragments around are same"
+
+            << "\n"
+
+            << "  -g --ordering [POLICY]"
+            << "        "
+            << "random/dist/congestion/pressure, with -rand for weighted "
+               "random"
+
             << std::endl;
 }
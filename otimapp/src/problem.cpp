@@ -9,6 +9,7 @@
 Problem::Problem(const std::string& _instance)
     : instance(_instance),
       G(nullptr),
+      GV(nullptr),
       seed(DEFAULT_SEED),
       MT(nullptr),
       max_comp_time(DEFAULT_MAX_COMP_TIME),
@@ -98,6 +99,8 @@ Problem::Problem(const std::string& _instance)
 
   // set default value not identified params
   if (MT == nullptr) MT = new std::mt19937(seed);
+  if (G == nullptr) halt("map file is not specified");
+  GV = new GraphView(G);
 
   // check starts/goals
   if (num_agents <= 0) halt("invalid number of agents");
@@ -121,6 +124,7 @@ Problem::Problem(int _nodes_size, float _prob, int _num_agents, int _seed = 0)
     : instance("random(" + std::to_string(_nodes_size) + "," +
                std::to_string(_prob) + ")_" + std::to_string(_seed)),
       G(new RandomGraph(_nodes_size, _prob, _seed)),
+      GV(new GraphView(G)),
       seed(_seed),
       MT(new std::mt19937(_seed)),
       num_agents(_num_agents),
@@ -132,10 +136,18 @@ Problem::Problem(int _nodes_size, float _prob, int _num_agents, int _seed = 0)
 
 Problem::~Problem()
 {
+  if (GV != nullptr) delete GV;
   if (G != nullptr) delete G;
   if (MT != nullptr) delete MT;
 }
 
+void Problem::setNodeOrder(const GraphView::Order order)
+{
+  if (GV->getOrder() == order) return;
+  delete GV;
+  GV = new GraphView(G, order);
+}
+
 Node* Problem::getStart(int i) const
 {
   if (!(0 <= i && i < (int)config_s.size())) halt("invalid index");
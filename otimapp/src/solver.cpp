@@ -8,6 +8,7 @@ MinimumSolver::MinimumSolver(Problem* _P)
     : solver_name(""),
       P(_P),
       G(_P->getG()),
+      GV(_P->getGraphView()),
       MT(_P->getMT()),
       max_comp_time(P->getMaxCompTime()),
       solved(false),
@@ -23,7 +24,11 @@ void MinimumSolver::solve()
   end();
 }
 
-void MinimumSolver::start() { t_start = Time::now(); }
+void MinimumSolver::start()
+{
+  t_start = Time::now();
+  deadline.set(t_start, max_comp_time);
+}
 
 void MinimumSolver::end() { comp_time = getSolverElapsedTime(); }
 
@@ -39,12 +44,19 @@ int MinimumSolver::getSolverElapsedTime() const
 Solver::Solver(Problem* _P)
     : MinimumSolver(_P),
       verbose(false),
-      distance_table(P->getNum(),
-                     std::vector<int>(G->getNodesSize(), G->getNodesSize())),
+      distance_table(GV, P->getConfigGoal()),
+      max_distance_table_mb(0),
+      threads(1),
+      distance_table_cache(""),
       table_goals(G->getNodesSize(), false),
       elapsed_time_pathfinding(0),
-      elapsed_time_deadlock_detection(0)
+      elapsed_time_deadlock_detection(0),
+      elapsed_time_table_release(0),
+      use_bucket_queue(false)
 {
+  // reproducible by the seed of the instance
+  workspace.rng = SplitMix64(P->getSeed());
+  workspace.deadline = &deadline;
 }
 
 Solver::~Solver() {}
@@ -54,9 +66,15 @@ Solver::~Solver() {}
 // -------------------------------
 void Solver::exec()
 {
-  // create distance table
-  info("  pre-processing, create distance table by BFS & create goal table");
-  createDistanceTable();  // 用于计算h-value
+  // distance tables are created by BFS when used, 用于计算h-value
+  info("  pre-processing, create goal table");
+  if (max_distance_table_mb > 0) {
+    distance_table.setMaxBytes((size_t)max_distance_table_mb << 20);
+  }
+  if (!distance_table_cache.empty()) {
+    distance_table.setCacheDir(distance_table_cache);
+  }
+  if (threads > 1) distance_table.computeAll(threads);
   for (int i = 0; i < P->getNum(); ++i) table_goals[P->getGoal(i)->id] = true;
   info("  done, elapsed: ", getSolverElapsedTime());
 
@@ -72,10 +90,9 @@ int Solver::getRemainedTime() const
   return std::max(0, max_comp_time - getSolverElapsedTime());
 }
 
-bool Solver::overCompTime() const
-{
-  return getSolverElapsedTime() >= max_comp_time;
-}
+// exact, for boundaries of outer loops; a single step there, e.g., one
+// search or registration, may be much more expensive than a unit of work
+bool Solver::overCompTime() const { return deadline.expiredNow(); }
 
 // -------------------------------
 // utilities for debug
@@ -125,6 +142,24 @@ void Solver::makeLogBasicInfo(std::ofstream& log)
   log << "elapsed_pathfinding=" << elapsed_time_pathfinding << "\n";
   log << "elapsed_deadlock_detection=" << elapsed_time_deadlock_detection
       << "\n";
+  log << "elapsed_table_release=" << elapsed_time_table_release << "\n";
+  log << "astar_expanded=" << workspace.expanded << "\n";
+  log << "deadline_clock_reads=" << deadline.getClockCnt() << "\n";
+  log << "distance_tables=" << distance_table.getTablesSize() << "\n";
+  log << "distance_table_bfs=" << distance_table.getComputedCnt() << "\n";
+  log << "distance_table_cache_hits=" << distance_table.getCacheHits()
+      << "\n";
+  log << "threads=" << threads << "\n";
+  log << "node_order=" << GraphView::getOrderName(GV->getOrder()) << "\n";
+}
+
+void Solver::makeLogFragmentIndex(std::ofstream& log,
+                                  const TableFragment* table)
+{
+  if (table == nullptr) return;
+  log << "fragment_index_probes=" << table->index.probes << "\n";
+  log << "fragment_index_hits=" << table->index.hits << "\n";
+  log << "fragment_index_collisions=" << table->index.collisions << "\n";
 }
 
 void Solver::makeLogSolution(std::ofstream& log)
@@ -185,37 +220,8 @@ void Solver::printHelpWithoutOption(const std::string& solver_name)
 // distance
 // 对于agent i, 计算当前s节点到目标节点的距离(用于计算h-value)
 // -------------------------------
-int Solver::pathDist(const int i, Node* const s) const
-{
-  return distance_table[i][s->id];
-}
-
 int Solver::pathDist(const int i) const { return pathDist(i, P->getStart(i)); }
 
-// 为每个目标节点构建一张到其他节点的最短路径距离表
-// 用于h的计算
-void Solver::createDistanceTable()
-{
-  for (int i = 0; i < P->getNum(); ++i) {
-    // breadth first search
-    std::queue<Node*> OPEN;
-    Node* n = P->getGoal(i);  // 目标位置
-    OPEN.push(n);
-    distance_table[i][n->id] = 0;
-    while (!OPEN.empty()) {
-      n = OPEN.front();
-      OPEN.pop();
-      const int d_n = distance_table[i][n->id];
-      for (auto m : n->neighbor) {
-        const int d_m = distance_table[i][m->id];
-        if (d_n + 1 >= d_m) continue;
-        distance_table[i][m->id] = d_n + 1;
-        OPEN.push(m);
-      }
-    }
-  }
-}
-
 // -------------------------------
 // utilities for getting path
 // -------------------------------
@@ -227,84 +233,63 @@ Solver::CompareAstarNodes Solver::compareAstarNodesDefault = [](AstarNode* a,
   return false;
 };
 
-// single agent path finding: A* (根据死锁约束进行了改造)
-Path Solver::getPath(const int id, CheckInvalidMove checkInvalidNode,
+Path Solver::getPath(const int id, CheckInvalidMove checkInvalidMove,
                      CompareAstarNodes compare)
 {
-  // 获取开始位置和目标位置
-  Node* const s = P->getStart(id);
-  Node* const g = P->getGoal(id);
-
-  // GC 被用作垃圾回收的容器，保存所有创建的 AstarNode
-  // 指针，以便在后续需要时统一处理（如释放内存）
-  AstarNodes GC;  // garbage collection ??
-  auto createNewNode = [&GC](Node* v, int g, int f, AstarNode* p) {
-    // 𝑓(𝑛)=𝑔(𝑛)+ℎ(𝑛)
-    // 𝑔(𝑛): 𝑐𝑜𝑠𝑡_𝑠𝑜_𝑓𝑎𝑟，表示当前点𝑛到起点的距离
-    // ℎ(𝑛): 启发函数，表示当前点𝑛到目标点的距离
-    AstarNode* new_node = new AstarNode{v, g, f, p};
-    GC.push_back(new_node);
-    return new_node;
-  };
-
-  // OPEN and CLOSE list
-  std::priority_queue<AstarNode*, AstarNodes, decltype(compare)> OPEN(compare);
-  std::vector<bool> CLOSE(G->getNodesSize(), false);  // 已扩展的node存在CLOSE中
-
-  // initial node
-  AstarNode* n = createNewNode(s, 0, pathDist(id, s), nullptr);
-  OPEN.push(n);
-
-  // main loop
-  bool invalid = true;
-  while (!OPEN.empty()) {
-    // check time limit
-    if (overCompTime()) break;
-
-    // minimum node
-    n = OPEN.top();
-    OPEN.pop();
-
-    // check CLOSE list
-    if (CLOSE[n->v->id]) continue;
-    CLOSE[n->v->id] = true;
-
-    // check goal condition
-    if (n->v == g) {
-      invalid = false;
-      break;
-    }
+  return getPath<CheckInvalidMove&, CompareAstarNodes&>(id, checkInvalidMove,
+                                                        compare);
+}
 
-    // expand
-    Nodes C = n->v->neighbor;
-    std::shuffle(C.begin(), C.end(), *MT);  // randomize
-    for (auto u : C) {
-      // already searched?
-      if (CLOSE[u->id]) continue;
-      // check constraints
-      if (checkInvalidNode(u, n->v)) continue;  // 违反了约束，如包含路径(u->v)
-      int g_cost = n->g + 1;
-      OPEN.push(createNewNode(u, g_cost, g_cost + pathDist(id, u), n));
-    }
+void Solver::SearchWorkspace::reset(const int nodes_size)
+{
+  used = 0;
+  OPEN.clear();
+  for (int k = 0; k <= bucket_max; ++k) buckets[k].clear();
+  bucket_cursor = 0;
+  bucket_max = -1;
+  bucket_nodes = 0;
+  if ((int)CLOSE.size() < nodes_size) CLOSE.resize(nodes_size, 0);
+  // avoid stale stamps after wrap around
+  if (++generation == 0) {
+    std::fill(CLOSE.begin(), CLOSE.end(), 0);
+    generation = 1;
   }
+}
 
-  Path path;
-  if (!invalid) {           // success
-    while (n != nullptr) {  // 构建path，该path满足约束
-      path.push_back(n->v);
-      n = n->p;
-    }
-    std::reverse(path.begin(), path.end());
+Solver::AstarNode* Solver::SearchWorkspace::createNewNode(Node* v, const int g,
+                                                          const int f,
+                                                          AstarNode* p)
+{
+  // 𝑓(𝑛)=𝑔(𝑛)+ℎ(𝑛)
+  // 𝑔(𝑛): 𝑐𝑜𝑠𝑡_𝑠𝑜_𝑓𝑎𝑟，表示当前点𝑛到起点的距离
+  // ℎ(𝑛): 启发函数，表示当前点𝑛到目标点的距离
+  if (used == (int)blocks.size() * BLOCK_SIZE) {
+    blocks.emplace_back(new AstarNode[BLOCK_SIZE]);
   }
+  auto new_node = &blocks[used / BLOCK_SIZE][used % BLOCK_SIZE];
+  ++used;
+  *new_node = {v, g, f, p};
+  return new_node;
+}
 
-  // free
-  for (auto p : GC) delete p;
-
-  return path;
+void Solver::SearchWorkspace::getCreatedNodes(std::vector<int>& ids)
+{
+  // remove duplicates by stamps of a new generation, by node ids
+  if (++generation == 0) {
+    std::fill(CLOSE.begin(), CLOSE.end(), 0);
+    generation = 1;
+  }
+  ids.clear();
+  for (int k = 0; k < used; ++k) {
+    const int v = blocks[k / BLOCK_SIZE][k % BLOCK_SIZE].v->id;
+    if (isClosed(v)) continue;
+    close(v);
+    ids.push_back(v);
+  }
 }
 
-Path Solver::getPrioritizedPath(const int id, const Plan& paths,
-                                TableFragment& table)
+Path Solver::getPrioritizedPath(SearchWorkspace& W, const int id,
+                                const Plan& paths, TableFragment& table)
 {
   Node* const g = P->getGoal(id);
 
@@ -327,11 +312,12 @@ Path Solver::getPrioritizedPath(const int id, const Plan& paths,
     // condition 2, avoid potential deadlocks
     // to fragment table[parent]
     for (auto c : table.t_to[parent->id]) {
-      if (c->path.front() == child) return true;
+      if (c->head() == child->id) return true;
     }
 
     return false;
   };
 
-  return getPath(id, checkInvalidNode, compare);
+  auto key = [](AstarNode* a) { return a->f; };
+  return getPath(W, id, checkInvalidNode, compare, key);
 }
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <dbs.hpp>
+#include <fstream>
+#include <map>
 
 #include "gtest/gtest.h"
 
@@ -10,3 +13,96 @@ TEST(DBS, solve)
 
   ASSERT_TRUE(solver->succeed());
 }
+
+TEST(DBS, seed)
+{
+  // DBS uses randomness only for the neighbor order of low-level search
+  // plans are compared by node ids, each instance has its own graph
+  auto solve = [](const std::string& instance) {
+    Problem P = Problem(instance);
+    auto solver = std::make_unique<DBS>(&P);
+    solver->solve();
+    EXPECT_TRUE(solver->succeed());
+    std::vector<std::vector<int>> plan;
+    for (auto& path : solver->getSolution()) {
+      plan.emplace_back();
+      for (auto v : path) plan.back().push_back(v->id);
+    }
+    return plan;
+  };
+  const std::string instance = "../tests/instances/example.txt";
+  auto plan = solve(instance);
+
+  // reproducible by the seed of the instance
+  ASSERT_EQ(solve(instance), plan);
+
+  // another seed breaks ties differently (seed=1 gives the same plan here)
+  const std::string instance_other = ::testing::TempDir() + "seed_other.txt";
+  {
+    std::ifstream in(instance);
+    std::ofstream out(instance_other);
+    std::string line;
+    while (std::getline(in, line)) {
+      out << (line.rfind("seed=", 0) == 0 ? "seed=2" : line) << "\n";
+    }
+  }
+  Problem P_other = Problem(instance_other);
+  ASSERT_EQ(P_other.getSeed(), 2);
+  auto plan_other = solve(instance_other);
+  ASSERT_EQ(solve(instance_other), plan_other);
+  ASSERT_NE(plan_other, plan);
+  std::remove(instance_other.c_str());
+}
+
+// number of head-on collisions, counted from scratch
+static int countHeadOnCollisions(const Plan& plan)
+{
+  std::map<std::pair<int, int>, int> edge_cnt;
+  for (auto& path : plan) {
+    for (int t = 1; t < (int)path.size(); ++t) {
+      ++edge_cnt[{path[t - 1]->id, path[t]->id}];
+    }
+  }
+  int head_on = 0;
+  for (auto& [e, cnt] : edge_cnt) {
+    if (e.first >= e.second) continue;
+    auto itr = edge_cnt.find({e.second, e.first});
+    if (itr != edge_cnt.end()) head_on += cnt * itr->second;
+  }
+  return head_on;
+}
+
+TEST(DBS, branching)
+{
+  Problem P = Problem("../tests/instances/dbs_branching.txt");
+  auto solver = std::make_unique<DBS>(&P);
+  solver->solve();
+
+  ASSERT_TRUE(solver->succeed());
+  ASSERT_GT(solver->getHighLevelExpanded(), 1);
+
+  // valid paths without potential deadlocks
+  auto solution = solver->getSolution();
+  auto table = TableFragment(P.getG());
+  for (int i = 0; i < P.getNum(); ++i) {
+    ASSERT_EQ(solution[i].front(), P.getStart(i));
+    ASSERT_EQ(solution[i].back(), P.getGoal(i));
+    for (int t = 1; t < (int)solution[i].size(); ++t) {
+      auto& C = solution[i][t - 1]->neighbor;
+      ASSERT_NE(std::find(C.begin(), C.end(), solution[i][t]), C.end());
+    }
+    ASSERT_EQ(table.registerNewPath(i, solution[i]), nullptr);
+  }
+
+  // incremental head-on collisions, compared with a full recount
+  ASSERT_EQ(solver->getHeadOnCollisions(), countHeadOnCollisions(solution));
+
+  // the same in the middle of the search, typically with collisions
+  for (int time_limit : {50, 200, 400}) {
+    P.setMaxCompTime(time_limit);
+    auto solver_interrupted = std::make_unique<DBS>(&P);
+    solver_interrupted->solve();
+    ASSERT_EQ(solver_interrupted->getHeadOnCollisions(),
+              countHeadOnCollisions(solver_interrupted->getLastNodePaths()));
+  }
+}
@@ -0,0 +1,151 @@
+#include <distance_table.hpp>
+#include <filesystem>
+#include <problem.hpp>
+#include <queue>
+
+#include "gtest/gtest.h"
+
+TEST(DistanceTable, basic)
+{
+  auto G = Grid("8x8.map");
+  auto GV = GraphView(&G);
+  auto g = G.getNode(27);
+  auto table = DistanceTable(&GV, {g, G.getNode(0), g});
+
+  // agents with the same goal share the table
+  ASSERT_EQ(table.getTablesSize(), 2);
+  ASSERT_EQ(table.getComputedCnt(), 0);
+
+  for (int v = 0; v < G.getNodesSize(); ++v) {
+    if (!G.existNode(v)) continue;
+    ASSERT_EQ(table.get(0, v), G.pathDist(G.getNode(v), g));
+    ASSERT_EQ(table.get(2, v), G.pathDist(G.getNode(v), g));
+  }
+  ASSERT_EQ(table.getComputedCnt(), 1);
+}
+
+TEST(DistanceTable, compact)
+{
+  // 65792 cells but fewer existing nodes, distances fit in 16 bits
+  auto G = Grid("den520d.map");
+  auto GV = GraphView(&G);
+  ASSERT_GE(G.getNodesSize(), (int)DistanceTable::UNREACHABLE);
+  int v = 0;
+  while (!G.existNode(v)) ++v;
+  auto table = DistanceTable(&GV, {G.getNode(v)});
+  ASSERT_TRUE(table.isCompact());
+  ASSERT_EQ(table.get(0, v), 0);
+  ASSERT_EQ(table.getUsedBytes(),
+            G.getNodesSize() * sizeof(DistanceTable::Dist));
+}
+
+TEST(DistanceTable, memoryLimit)
+{
+  auto G = Grid("8x8.map");
+  auto GV = GraphView(&G);
+  auto table = DistanceTable(&GV, {G.getNode(0), G.getNode(27)});
+  table.setMaxBytes(G.getNodesSize() * sizeof(DistanceTable::Dist));
+
+  // only one table is kept, the other is recomputed
+  ASSERT_EQ(table.get(0, 27), G.pathDist(G.getNode(27), G.getNode(0)));
+  ASSERT_EQ(table.get(1, 0), G.pathDist(G.getNode(0), G.getNode(27)));
+  ASSERT_EQ(table.get(0, 27), G.pathDist(G.getNode(27), G.getNode(0)));
+  ASSERT_EQ(table.getComputedCnt(), 3);
+  ASSERT_EQ(table.getUsedBytes(),
+            G.getNodesSize() * sizeof(DistanceTable::Dist));
+}
+
+TEST(DistanceTable, parallel)
+{
+  auto G = Grid("random-32-32-20.map");
+  auto GV = GraphView(&G);
+  std::vector<Node*> goals;
+  for (int v = 0; v < G.getNodesSize(); v += 37) {
+    if (G.existNode(v)) goals.push_back(G.getNode(v));
+  }
+  auto table_seq = DistanceTable(&GV, goals);
+  auto table_par = DistanceTable(&GV, goals);
+  table_seq.computeAll();
+  table_par.computeAll(4);
+  ASSERT_EQ(table_par.getComputedCnt(), table_par.getTablesSize());
+
+  // identical to the sequential version
+  for (int i = 0; i < (int)goals.size(); ++i) {
+    for (int v = 0; v < G.getNodesSize(); ++v) {
+      ASSERT_EQ(table_par.get(i, v), table_seq.get(i, v));
+    }
+  }
+  ASSERT_EQ(table_par.getComputedCnt(), table_par.getTablesSize());
+}
+
+TEST(DistanceTable, cache)
+{
+  auto G = Grid("8x8.map");
+  auto GV = GraphView(&G);
+  const std::string dir = ::testing::TempDir() + "otimapp_dist_cache";
+  std::filesystem::remove_all(dir);
+  std::vector<Node*> goals = {G.getNode(0), G.getNode(27)};
+
+  // first run, computed by BFS and stored
+  auto table = DistanceTable(&GV, goals);
+  table.setCacheDir(dir);
+  table.computeAll();
+  ASSERT_EQ(table.getComputedCnt(), 2);
+  ASSERT_EQ(table.getCacheHits(), 0);
+
+  // second run, loaded from the cache
+  auto table_cached = DistanceTable(&GV, goals);
+  table_cached.setCacheDir(dir);
+  table_cached.computeAll(2);
+  ASSERT_EQ(table_cached.getComputedCnt(), 0);
+  ASSERT_EQ(table_cached.getCacheHits(), 2);
+  for (int i = 0; i < 2; ++i) {
+    for (int v = 0; v < G.getNodesSize(); ++v) {
+      ASSERT_EQ(table_cached.get(i, v), table.get(i, v));
+    }
+  }
+
+  // different graph, not shared
+  auto G2 = Grid("random-32-32-20.map");
+  auto GV2 = GraphView(&G2);
+  auto table_other = DistanceTable(&GV2, {G2.getNode(0)});
+  table_other.setCacheDir(dir);
+  table_other.get(0, 0);
+  ASSERT_EQ(table_other.getCacheHits(), 0);
+  ASSERT_EQ(table_other.getComputedCnt(), 1);
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST(DistanceTable, bitboard)
+{
+  // compare with plain BFS, including a map wider than 64 cells
+  for (auto map_file : {"random-32-32-20.map", "den520d.map"}) {
+    auto G = Grid(map_file);
+    auto GV = GraphView(&G);
+    std::vector<Node*> goals;
+    for (int v = 0; v < G.getNodesSize(); v += G.getNodesSize() / 5 + 1) {
+      while (!G.existNode(v)) ++v;
+      goals.push_back(G.getNode(v));
+    }
+    auto table = DistanceTable(&GV, goals);
+    for (int i = 0; i < (int)goals.size(); ++i) {
+      std::vector<int> dist(G.getNodesSize(), G.getNodesSize());
+      std::queue<Node*> OPEN;
+      dist[goals[i]->id] = 0;
+      OPEN.push(goals[i]);
+      while (!OPEN.empty()) {
+        auto n = OPEN.front();
+        OPEN.pop();
+        for (auto m : n->neighbor) {
+          if (dist[m->id] <= dist[n->id] + 1) continue;
+          dist[m->id] = dist[n->id] + 1;
+          OPEN.push(m);
+        }
+      }
+      for (int v = 0; v < G.getNodesSize(); ++v) {
+        ASSERT_EQ(table.get(i, v), dist[v]);
+      }
+    }
+  }
+}
@@ -1,4 +1,6 @@
 #include <fragment.hpp>
+#include <problem.hpp>
+#include <set>
 
 #include "gtest/gtest.h"
 
@@ -68,3 +70,221 @@ TEST(TableFragment, selfLoop)
   auto c = table.registerNewPath(0, p);
   ASSERT_EQ(c, nullptr);
 }
+
+// reuse the table after clearing all fragments
+TEST(TableFragment, clear)
+{
+  auto G = Grid("3x3.map");
+  auto table = TableFragment(&G);
+
+  Path p1 = {G.getNode(0), G.getNode(1), G.getNode(2)};
+  Path p2 = {G.getNode(3), G.getNode(2), G.getNode(1)};
+  ASSERT_EQ(table.registerNewPath(0, p1), nullptr);
+  ASSERT_NE(table.registerNewPath(1, p2), nullptr);
+
+  table.clear();
+  for (auto fragments : table.t_from) ASSERT_TRUE(fragments.empty());
+  for (auto fragments : table.t_to) ASSERT_TRUE(fragments.empty());
+
+  ASSERT_EQ(table.registerNewPath(1, p2), nullptr);
+  ASSERT_NE(table.registerNewPath(0, p1), nullptr);
+}
+
+// fragments larger than inline storage
+TEST(TableFragment, largeFragment)
+{
+  auto G = Grid("8x8.map");
+  auto table = TableFragment(&G);
+
+  // agent i moves from node i to node i+1
+  for (int i = 0; i < 6; ++i) {
+    Path p = {G.getNode(i), G.getNode(i + 1)};
+    ASSERT_EQ(table.registerNewPath(i, p), nullptr);
+  }
+
+  Fragment* c = nullptr;
+  for (auto f : table.t_from[0]) {
+    if (c == nullptr || f->size > c->size) c = f;
+  }
+  ASSERT_NE(c, nullptr);
+  ASSERT_EQ(c->size, 6);
+  for (int i = 0; i < c->size; ++i) {
+    ASSERT_EQ(c->agents[i], i);
+    ASSERT_EQ(c->path[i], i);
+  }
+  ASSERT_EQ(c->tail(), 6);
+}
+
+TEST(Fragment, signatures)
+{
+  Fragment a, b;
+  int buf_a[] = {0, 1, 2, 64, 3};  // path: 0 -> 1 -> 2, agents: 64, 3
+  int buf_b[] = {5, 6, 0};         // path: 5 -> 6, agents: 0
+  a.size = 2;
+  a.path = buf_a;
+  a.agents = buf_a + 3;
+  a.setupSignatures();
+  b.size = 1;
+  b.path = buf_b;
+  b.agents = buf_b + 2;
+  b.setupSignatures();
+
+  // agent 64 and agent 0 share the same bit
+  ASSERT_FALSE(a.shareAgents(&b));
+  ASSERT_FALSE(a.shareNodes(&b));
+  ASSERT_TRUE(a.hasAgent(64));
+  ASSERT_FALSE(a.hasAgent(0));
+
+  buf_b[0] = 2;
+  b.setupSignatures();
+  ASSERT_TRUE(a.shareNodes(&b));
+  buf_b[2] = 3;
+  b.setupSignatures();
+  ASSERT_TRUE(a.shareAgents(&b));
+}
+
+TEST(TableFragment, duplication)
+{
+  auto G = Grid("3x3.map");
+  auto table = TableFragment(&G);
+
+  Path p = {G.getNode(0), G.getNode(1), G.getNode(2)};
+  ASSERT_EQ(table.registerNewPath(0, p), nullptr);
+  const int fragments_num = table.index.cnt;
+  ASSERT_EQ(table.index.hits, 0);
+
+  // the same path does not create new fragments
+  ASSERT_EQ(table.registerNewPath(0, p), nullptr);
+  ASSERT_EQ(table.index.cnt, fragments_num);
+  ASSERT_GT(table.index.hits, 0);
+}
+
+TEST(TableFragment, unregisterPath)
+{
+  auto G = Grid("3x3.map");
+  auto table = TableFragment(&G);
+
+  Path p1 = {G.getNode(0), G.getNode(1), G.getNode(2)};
+  Path p2 = {G.getNode(3), G.getNode(2), G.getNode(1)};
+  Path p3 = {G.getNode(3), G.getNode(4), G.getNode(5)};
+  ASSERT_EQ(table.registerNewPath(0, p1), nullptr);
+  const int fragments_num = table.index.cnt;
+  ASSERT_NE(table.registerNewPath(1, p2), nullptr);
+
+  // remove all fragments of agent 1
+  table.unregisterPath(1);
+  ASSERT_EQ(table.index.cnt, fragments_num);
+  for (auto fragments : table.t_from) {
+    for (auto c : fragments) ASSERT_FALSE(c->hasAgent(1));
+  }
+  for (auto fragments : table.t_to) {
+    for (auto c : fragments) ASSERT_FALSE(c->hasAgent(1));
+  }
+
+  // replace the path
+  ASSERT_EQ(table.registerNewPath(1, p3), nullptr);
+  table.unregisterPath(1);
+  ASSERT_NE(table.registerNewPath(1, p2), nullptr);
+}
+
+// unregistering gives the same fragments as registering without the agent
+TEST(TableFragment, unregisterPathConsistency)
+{
+  auto G = Grid("8x8.map");
+  Plan paths = {
+      G.getPath(G.getNode(0), G.getNode(27), false),
+      G.getPath(G.getNode(24), G.getNode(3), false),
+      G.getPath(G.getNode(26), G.getNode(1), false),
+      G.getPath(G.getNode(9), G.getNode(16), false),
+  };
+  auto getFragments = [](TableFragment& table) {
+    std::multiset<std::pair<std::vector<int>, std::set<int>>> fragments;
+    for (auto cs : table.t_from) {
+      for (auto c : cs) {
+        fragments.emplace(std::vector<int>(c->path, c->path + c->size + 1),
+                          std::set<int>(c->agents, c->agents + c->size));
+      }
+    }
+    return fragments;
+  };
+
+  auto table1 = TableFragment(&G);
+  for (int i = 0; i < (int)paths.size(); ++i) {
+    table1.registerNewPath(i, paths[i], true);
+  }
+  table1.unregisterPath(1);
+
+  auto table2 = TableFragment(&G);
+  for (int i = 0; i < (int)paths.size(); ++i) {
+    if (i != 1) table2.registerNewPath(i, paths[i], true);
+  }
+
+  ASSERT_EQ(getFragments(table1), getFragments(table2));
+  ASSERT_EQ(table1.index.cnt, table2.index.cnt);
+}
+
+TEST(TableFragment, rollback)
+{
+  auto G = Grid("8x8.map");
+  Plan paths = {
+      G.getPath(G.getNode(0), G.getNode(27), false),
+      G.getPath(G.getNode(24), G.getNode(3), false),
+      G.getPath(G.getNode(26), G.getNode(1), false),
+      G.getPath(G.getNode(9), G.getNode(16), false),
+  };
+
+  auto table1 = TableFragment(&G);
+  table1.registerNewPath(0, paths[0], true);
+  table1.registerNewPath(1, paths[1], true);
+  const int checkpoint = table1.getCheckpoint();
+  table1.registerNewPath(2, paths[2], true);
+  table1.registerNewPath(3, paths[3], true);
+  table1.rollback(checkpoint);
+  ASSERT_EQ(table1.getCheckpoint(), checkpoint);
+  ASSERT_TRUE(table1.t_agent[2].empty());
+  ASSERT_TRUE(table1.t_agent[3].empty());
+
+  // registration continues as usual
+  table1.registerNewPath(3, paths[3], true);
+
+  auto table2 = TableFragment(&G);
+  for (auto i : {0, 1, 3}) table2.registerNewPath(i, paths[i], true);
+
+  ASSERT_EQ(table1.getCheckpoint(), table2.getCheckpoint());
+  ASSERT_EQ(table1.index.cnt, table2.index.cnt);
+  ASSERT_EQ(table1.cycles.size(), table2.cycles.size());
+}
+
+TEST(TableFragment, fingerprint)
+{
+  auto G = Grid("8x8.map");
+  Plan paths = {
+      G.getPath(G.getNode(0), G.getNode(27), false),
+      G.getPath(G.getNode(24), G.getNode(3), false),
+      G.getPath(G.getNode(26), G.getNode(1), false),
+  };
+  std::vector<int> nodes;
+  for (int v = 0; v < G.getNodesSize(); ++v) nodes.push_back(v);
+
+  auto table = TableFragment(&G);
+  const uint64_t fp_empty = table.getFingerprint(nodes);
+  table.registerNewPath(0, paths[0], true);
+  table.registerNewPath(1, paths[1], true);
+  const uint64_t fp = table.getFingerprint(nodes);
+  ASSERT_NE(fp, fp_empty);
+
+  // depends only on registered fragments
+  const int checkpoint = table.getCheckpoint();
+  table.registerNewPath(2, paths[2], true);
+  ASSERT_NE(table.getFingerprint(nodes), fp);
+  table.rollback(checkpoint);
+  ASSERT_EQ(table.getFingerprint(nodes), fp);
+  table.registerNewPath(2, paths[2], true);
+  table.unregisterPath(2);
+  ASSERT_EQ(table.getFingerprint(nodes), fp);
+  table.clear();
+  ASSERT_EQ(table.getFingerprint(nodes), fp_empty);
+  table.registerNewPath(0, paths[0], true);
+  table.registerNewPath(1, paths[1], true);
+  ASSERT_EQ(table.getFingerprint(nodes), fp);
+}
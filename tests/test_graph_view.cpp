@@ -0,0 +1,76 @@
+#include <distance_table.hpp>
+#include <graph_view.hpp>
+
+#include "gtest/gtest.h"
+
+TEST(GraphView, basic)
+{
+  auto G = Grid("8x8.map");
+  auto GV = GraphView(&G);
+  ASSERT_TRUE(GV.isGrid());
+  ASSERT_EQ(GV.getNodesSize(), G.getNodesSize());
+
+  int edges = 0;
+  for (int v = 0; v < GV.getNodesSize(); ++v) {
+    ASSERT_EQ(GV.existNode(v), G.existNode(v));
+    if (!GV.existNode(v)) continue;
+    ASSERT_EQ(GV.getIndex(v), v);
+    auto& neighbor = G.getNode(v)->neighbor;
+    ASSERT_EQ(GV.getDegree(v), (int)neighbor.size());
+    for (int j = 0; j < (int)neighbor.size(); ++j) {
+      ASSERT_EQ(GV.getNeighbors(v)[j], neighbor[j]->id);
+      ASSERT_EQ(GV.getEdgeIndex(v, neighbor[j]->id), edges++);
+    }
+  }
+  ASSERT_EQ(GV.getEdgesSize(), edges);
+  ASSERT_EQ(GV.getEdgeIndex(0, 63), -1);
+}
+
+TEST(GraphView, renumbering)
+{
+  auto G = Grid("random-32-32-20.map");
+  auto GV = GraphView(&G);
+  for (auto order : {GraphView::MORTON, GraphView::HILBERT}) {
+    auto GV_r = GraphView(&G, order);
+    ASSERT_EQ(GV_r.getOrder(), order);
+
+    // bijection, and the same adjacency
+    std::vector<bool> used(G.getNodesSize(), false);
+    for (int id = 0; id < G.getNodesSize(); ++id) {
+      const int v = GV_r.getIndex(id);
+      ASSERT_FALSE(used[v]);
+      used[v] = true;
+      ASSERT_EQ(GV_r.getId(v), id);
+      ASSERT_EQ(GV_r.getNode(v), G.getNode(id));
+      if (!G.existNode(id)) continue;
+      ASSERT_EQ(GV_r.getX(v), G.getNode(id)->pos.x);
+      ASSERT_EQ(GV_r.getY(v), G.getNode(id)->pos.y);
+      auto C = GV_r.getNeighbors(v);
+      for (int j = 0; j < C.size(); ++j) {
+        ASSERT_EQ(GV_r.getId(C[j]), G.getNode(id)->neighbor[j]->id);
+      }
+    }
+
+    // the same distances
+    std::vector<Node*> goals;
+    for (int id : {33, 500}) {
+      while (!G.existNode(id)) ++id;
+      goals.push_back(G.getNode(id));
+    }
+    auto table = DistanceTable(&GV, goals);
+    auto table_r = DistanceTable(&GV_r, goals);
+    for (int i = 0; i < 2; ++i) {
+      for (int id = 0; id < G.getNodesSize(); ++id) {
+        ASSERT_EQ(table_r.get(i, GV_r.getIndex(id)), table.get(i, id));
+      }
+    }
+  }
+
+  // curve neighbors are close on the grid
+  auto GV_h = GraphView(&G, GraphView::HILBERT);
+  for (int v = 1; v < G.getNodesSize(); ++v) {
+    const int d = std::abs(GV_h.getX(v) - GV_h.getX(v - 1)) +
+                  std::abs(GV_h.getY(v) - GV_h.getY(v - 1));
+    ASSERT_EQ(d, 1);
+  }
+}
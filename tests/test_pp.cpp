@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <pp.hpp>
 
 #include "gtest/gtest.h"
@@ -10,3 +11,200 @@ TEST(PP, solve)
 
   ASSERT_TRUE(solver->succeed());
 }
+
+TEST(PP, bucketQueue)
+{
+  Problem P = Problem("../tests/instances/example.txt");
+  auto solver = std::make_unique<PP>(&P);
+  solver->setBucketQueue(true);
+  solver->solve();
+
+  ASSERT_TRUE(solver->succeed());
+  auto solution = solver->getSolution();
+  for (int i = 0; i < P.getNum(); ++i) {
+    ASSERT_EQ(solution[i].front(), P.getStart(i));
+    ASSERT_EQ(solution[i].back(), P.getGoal(i));
+  }
+}
+
+TEST(PP, cancel)
+{
+  Problem P = Problem("../tests/instances/example.txt");
+  auto solver = std::make_unique<PP>(&P);
+  solver->cancel();
+  solver->solve();
+
+  ASSERT_FALSE(solver->succeed());
+}
+
+TEST(PP, restarts)
+{
+  // solved after several restarts
+  Problem P = Problem("../tests/instances/pp_restarts.txt");
+  char arg0[] = "app", arg1[] = "-m", arg2[] = "100";
+  char* argv[] = {arg0, arg1, arg2};
+  auto solver = std::make_unique<PP>(&P);
+  solver->setParams(3, argv);
+  solver->setThreads(2);
+  solver->solve();
+  ASSERT_TRUE(solver->succeed());
+  const int iter = solver->getRestartIteration();
+  ASSERT_GT(iter, 1);
+
+  // iterations only depend on their numbers, reproduced in one thread
+  auto iter_str = std::to_string(iter);
+  char arg3[] = "-a";
+  char* argv_restart[] = {arg0, arg1, arg2, arg3, iter_str.data()};
+  auto solver_restart = std::make_unique<PP>(&P);
+  solver_restart->setParams(5, argv_restart);
+  solver_restart->solve();
+  ASSERT_TRUE(solver_restart->succeed());
+  ASSERT_EQ(solver_restart->getRestartIteration(), iter);
+  ASSERT_EQ(solver_restart->getSolution(), solver->getSolution());
+}
+
+TEST(PP, prefixRestart)
+{
+  Problem P = Problem("../tests/instances/example.txt");
+  char arg0[] = "app", arg1[] = "-R", arg2[] = "prefix";
+  char* argv[] = {arg0, arg1, arg2};
+  auto solver = std::make_unique<PP>(&P);
+  solver->setParams(3, argv);
+  solver->solve();
+  ASSERT_TRUE(solver->succeed());
+
+  // no potential deadlock
+  auto solution = solver->getSolution();
+  auto table = TableFragment(P.getG());
+  for (int i = 0; i < P.getNum(); ++i) {
+    ASSERT_EQ(table.registerNewPath(i, solution[i]), nullptr);
+  }
+
+  // the first agent is blocked by goals of others in any order
+  Problem P_blocked = Problem("../tests/instances/goal_blocked.txt");
+  auto solver_blocked = std::make_unique<PP>(&P_blocked);
+  solver_blocked->setParams(3, argv);
+  solver_blocked->solve();
+  ASSERT_FALSE(solver_blocked->succeed());
+  ASSERT_TRUE(solver_blocked->isUnsolvable());
+}
+
+TEST(PP, pathCache)
+{
+  Problem P = Problem("../tests/instances/example.txt");
+  char arg0[] = "app", arg1[] = "-c", arg2[] = "-R", arg3[] = "prefix";
+  char* argv[] = {arg0, arg1, arg2, arg3};
+  auto solver = std::make_unique<PP>(&P);
+  solver->setParams(4, argv);
+  solver->solve();
+  ASSERT_TRUE(solver->succeed());
+
+  // reused paths are also free from potential deadlocks
+  auto solution = solver->getSolution();
+  auto table = TableFragment(P.getG());
+  for (int i = 0; i < P.getNum(); ++i) {
+    ASSERT_EQ(solution[i].front(), P.getStart(i));
+    ASSERT_EQ(solution[i].back(), P.getGoal(i));
+    ASSERT_EQ(table.registerNewPath(i, solution[i]), nullptr);
+  }
+
+  // restarts with derived seeds, cached paths do not change the results
+  Problem P_restarts = Problem("../tests/instances/pp_path_cache.txt");
+  char arg4[] = "-f", arg5[] = "4", arg6[] = "-m", arg7[] = "1000";
+  char arg8[] = "-a", arg9[] = "1";
+  for (int threads : {1, 2}) {
+    char* argv_cache[] = {arg0, arg1, arg4, arg5, arg6, arg7, arg8, arg9};
+    auto solver_cache = std::make_unique<PP>(&P_restarts);
+    solver_cache->setParams(8, argv_cache);
+    solver_cache->setThreads(threads);
+    solver_cache->solve();
+    ASSERT_TRUE(solver_cache->succeed());
+    ASSERT_GT(solver_cache->getPathCacheHits(), 0);
+
+    // rerun from the iteration, without paths of the previous iterations
+    auto iter_str = std::to_string(solver_cache->getRestartIteration());
+    argv_cache[7] = iter_str.data();
+    auto solver_restart = std::make_unique<PP>(&P_restarts);
+    solver_restart->setParams(8, argv_cache);
+    solver_restart->solve();
+    ASSERT_TRUE(solver_restart->succeed());
+    ASSERT_EQ(solver_restart->getSolution(), solver_cache->getSolution());
+  }
+}
+
+TEST(PP, ordering)
+{
+  // needs several iterations, to accumulate pressure
+  const std::string instance = "../tests/instances/pp_restarts.txt";
+  const int ITERS = 8;
+  for (std::string name : {"random", "dist", "congestion", "pressure",
+                           "dist-rand", "congestion-rand", "pressure-rand"}) {
+    // the instance holds the random generator, loaded for each run
+    Problem P = Problem(instance);
+    auto G = P.getG();
+    const int N = P.getNum();
+    char arg0[] = "app", arg1[] = "-g", arg3[] = "-m", arg4[] = "100";
+    char* argv[] = {arg0, arg1, name.data(), arg3, arg4};
+    auto solver = std::make_unique<PP>(&P);
+    solver->setParams(5, argv);
+    solver->solve();
+    ASSERT_TRUE(solver->succeed());
+
+    // keys of each policy
+    const auto& keys = solver->getOrderKeys();
+    ASSERT_EQ((int)keys.size(), N);
+    const bool all_zero =
+        std::all_of(keys.begin(), keys.end(), [](double k) { return k == 0; });
+    ASSERT_EQ(all_zero, name == "random");
+    if (name.rfind("dist", 0) == 0) {
+      for (int i = 0; i < N; ++i) {
+        ASSERT_EQ(keys[i], G->pathDist(P.getStart(i), P.getGoal(i)));
+      }
+    }
+
+    // keys in the order of planning
+    auto getOrderedKeys = [&](const std::vector<int>& order) {
+      std::vector<double> ordered_keys;
+      for (auto i : order) ordered_keys.push_back(keys[i]);
+      return ordered_keys;
+    };
+    const bool randomized = name.find("-rand") != std::string::npos;
+    bool reordered_keys = false;  // -rand departs from the sorted order
+    bool reordered_ties = false;  // iterations differ among ties
+    const auto order_first = solver->getIterationOrder(1);
+    const auto keys_first = getOrderedKeys(order_first);
+    for (int iter = 1; iter <= ITERS; ++iter) {
+      auto order = solver->getIterationOrder(iter);
+      // a permutation, reproducible for a fixed seed
+      auto sorted = order;
+      std::sort(sorted.begin(), sorted.end());
+      for (int i = 0; i < N; ++i) ASSERT_EQ(sorted[i], i);
+      ASSERT_EQ(solver->getIterationOrder(iter), order);
+      if (order != order_first) reordered_ties = true;
+
+      auto ordered_keys = getOrderedKeys(order);
+      const bool non_increasing =
+          std::is_sorted(ordered_keys.rbegin(), ordered_keys.rend());
+      if (randomized) {
+        if (!non_increasing) reordered_keys = true;
+      } else {
+        // larger keys first, only agents with the same key are shuffled
+        ASSERT_TRUE(non_increasing);
+        ASSERT_EQ(ordered_keys, keys_first);
+      }
+    }
+    ASSERT_TRUE(reordered_ties);
+    ASSERT_EQ(reordered_keys, randomized);
+
+    // the same orders in another run with the same seed
+    Problem P_again = Problem(instance);
+    auto solver_again = std::make_unique<PP>(&P_again);
+    solver_again->setParams(5, argv);
+    solver_again->solve();
+    ASSERT_EQ(solver_again->getOrderKeys(), keys);
+    for (int iter = 1; iter <= ITERS; ++iter) {
+      ASSERT_EQ(solver_again->getIterationOrder(iter),
+                solver->getIterationOrder(iter));
+    }
+  }
+}